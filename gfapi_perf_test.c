@@ -3,7 +3,9 @@
  *
  * install the glusterfs-api RPM before trying to compile and link
  *
- * to compile: gcc -pthread -g -O0  -Wall --pedantic -o gfapi_perf_test -I /usr/include/glusterfs/api gfapi_perf_test.c  -lgfapi -lrt
+ * GFAPI_QDEPTH > 1 uses glfs_p{read,write}_async with libgfapi and io_uring (raw syscalls, kernel 5.6+) with POSIX
+ *
+ * to compile: gcc -pthread -g -O0  -Wall --pedantic -o gfapi_perf_test -I /usr/include/glusterfs/api gfapi_perf_test.c  -lgfapi -lrt -lm
  *
  * environment variables used as inputs, see usage() below
  *
@@ -29,8 +31,21 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/time.h>
+#include <sys/mman.h>
+#include <sys/xattr.h>
+#include <sys/uio.h>
+#include <limits.h>
+#include <dirent.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <signal.h>
 #include <pthread.h>
+#include <semaphore.h>
+#include <sched.h>
+#include <linux/mempolicy.h>
 #include <fcntl.h>
+#include <linux/io_uring.h>
 #include "glfs.h"
 
 #define NOTOK 1 /* process exit status indicates error of some sort */
@@ -38,20 +53,81 @@
 #define KB_PER_MB 1024
 #define BYTES_PER_KB 1024
 #define BYTES_PER_MB (1024*1024)
+#define BYTES_PER_GB (1024.0*1024*1024)
 #define KB_PER_MB 1024
 #define NSEC_PER_SEC 1000000000.0
 #define UINT64DFMT "%ld"
 
 /* power of 2 corresponding to 4096-byte page boundary, used in memalign() call */
 #define PAGE_BOUNDARY 12 
+#define MAX_NUMA_NODES 64
+#define NUMA_DEFAULT 0             /* GFAPI_NUMA_POLICY values */
+#define NUMA_LOCAL 1
+#define NUMA_NODES 2
+#define FILE_PHASE_OPEN 0          /* parts of each file's life, timed separately */
+#define FILE_PHASE_IO 1
+#define FILE_PHASE_FSYNC 2
+#define FILE_PHASE_CLOSE 3
+#define FILE_PHASES 4
+static const char * file_phase_names[FILE_PHASES] = { "open", "I/O", "fsync", "close" };
+#define CONTENT_BLOCK 4096         /* compressibility and dedupe are set per 4 KB block, the usual dedupe granularity */
+#define CONTENT_POOL_SIZE (1 << 20) /* random bytes that written blocks are copied from */
+#define DEDUPE_BLOCKS 64           /* distinct contents that duplicate blocks are drawn from */
+#define MAX_SIZE_CLASSES 8         /* record or file sizes in a GFAPI_RECSZ or GFAPI_FSZ list */
+#define SYNC_NONE 0                /* GFAPI_SYNC_MODE, how writes are made durable besides GFAPI_FSYNC_AT_CLOSE */
+#define SYNC_FSYNC 1
+#define SYNC_FDATASYNC 2
+#define SYNC_OSYNC 3
+#define SYNC_ODSYNC 4
+static const char * sync_mode_names[] = { "none", "fsync", "fdatasync", "osync", "odsync", NULL };
+#define SHARED_NONE 0              /* GFAPI_SHARED_FILE layouts, how threads divide one file's records */
+#define SHARED_STRIDED 1
+#define SHARED_BLOCKED 2
+#define SHARED_RANDOM 3
+/* per-thread structures are aligned to this so threads never write to the same cache line */
+#define CACHE_LINE 64
 
 #define FOREACH(_index, _count) for(_index=0; _index < (_count); _index++)
 
+/* latency histogram is log-bucketed (HDR-style): values below 2^LAT_SUB_BITS ns get their own bucket,
+ * above that each power of 2 is split into 2^LAT_SUB_BITS linear sub-buckets, so error is about 3%.
+ * latencies are clamped to 2^LAT_MAX_BITS ns (about 18 minutes) to bound the bucket count */
+#define LAT_SUB_BITS 5
+#define LAT_SUB_BUCKETS (1 << LAT_SUB_BITS)
+#define LAT_MAX_BITS 40
+#define LAT_BUCKETS ((LAT_MAX_BITS - LAT_SUB_BITS + 1) * LAT_SUB_BUCKETS)
+
+/* operation types that get their own latency histogram */
+static const char * op_names[] = { "open", "read", "write", "fsync", "close", "unlink", 
+   "stat", "chmod", "getxattr", "setxattr", "rename", "create", "mkdir", "readdir", "sync", "rmdir", NULL };
+#define OP_OPEN 0
+#define OP_READ 1
+#define OP_WRITE 2
+#define OP_FSYNC 3
+#define OP_CLOSE 4
+#define OP_UNLINK 5
+#define OP_STAT 6
+#define OP_CHMOD 7
+#define OP_GETXATTR 8
+#define OP_SETXATTR 9
+#define OP_RENAME 10
+#define OP_CREATE 11
+#define OP_MKDIR 12
+#define OP_READDIR 13
+#define OP_SYNC 14                 /* periodic fsync or fdatasync from GFAPI_SYNC_MODE, apart from fsync at close */
+#define OP_RMDIR 15
+#define OP_TYPES 16
+
 /* last array element of workload_types must be NULL */
 static const char * workload_types[] = 
-   { "seq-wr", "seq-rd", "rnd-wr", "rnd-rd", "unlink", "seq-rdwrmix", NULL };
+   { "seq-wr", "seq-rd", "rnd-wr", "rnd-rd", "unlink", "seq-rdwrmix", 
+     "stat", "chmod", "getxattr", "setxattr", "rename", "create", "mkdir", "ls-l", "replay", 
+     "rmtree", "prepopulate", "readdir", "find", NULL };
 static const char * workload_description[] = 
-   { "sequential write", "sequential read", "random write", "random read", "delete", "sequential read-write mix", NULL };
+   { "sequential write", "sequential read", "random write", "random read", "delete", "sequential read-write mix", 
+     "stat", "change mode", "get xattr", "set xattr", "rename", "create empty file", "make directory", 
+     "list directory and stat entries", "replay a trace", "remove directory tree", "populate directory tree", 
+     "list leaf directories", "walk and list directory tree", NULL };
 /* define numeric workload types as indexes into preceding array */
 #define WL_SEQWR 0
 #define WL_SEQRD 1
@@ -59,21 +135,174 @@ static const char * workload_description[] =
 #define WL_RNDRD 3
 #define WL_DELETE 4
 #define WL_SEQRDWRMIX 5
+/* metadata-only workloads, these must come after all workloads that do data I/O */
+#define WL_STAT 6
+#define WL_CHMOD 7
+#define WL_GETXATTR 8
+#define WL_SETXATTR 9
+#define WL_RENAME 10
+#define WL_CREATE 11
+#define WL_MKDIR 12
+#define WL_LSL 13
+#define WL_FIRST_METADATA WL_STAT
+/* replays GFAPI_TRACE_FILE, which can have any mix of operations */
+#define WL_REPLAY 14
+/* walk GFAPI_BASEDIR with a work-stealing pool: remove everything beneath it, make the files of every thread,
+ * list the leaf directories those files are in, or list every directory beneath it */
+#define WL_RMTREE 15
+#define WL_PREPOPULATE 16
+#define WL_READDIR 17
+#define WL_FIND 18
+#define WL_FIRST_TREE WL_RMTREE
+
+/* readdir and find report listing time by directory size, in classes of up to 16, 64, 256 ... entries */
+#define DIRSZ_CLASSES 8
+#define DIRSZ_SMALLEST 16
+
+/* extended attribute used by getxattr and setxattr workloads */
+#define XATTR_NAME "user.gfapi_perf_test"
+#define XATTR_VALUE_SIZE 64
+
+static glfs_t ** glfs_instances = NULL;  /* one libgfapi mount per GFAPI_INSTANCES */
+
+/* access distributions for GFAPI_DIST, applied to both file selection and record offsets */
+#define DIST_NONE 0     /* files in order, each record once in pseudo-random order */
+#define DIST_UNIFORM 1
+#define DIST_ZIPF 2
+#define DIST_HOTSPOT 3
+
+struct access_dist {
+  int type;                        /* one of DIST_* */
+  uint64_t n;                      /* number of items (files or records) to choose from */
+  double theta;                    /* zipf skew, between 0 and 1 */
+  double alpha, zetan, eta, half_pow_theta;  /* zipf constants derived from theta and n */
+  double hot_data_frac;            /* hotspot: fraction of items that are hot */
+  double hot_access_frac;          /* hotspot: fraction of accesses that go to hot items */
+};
+typedef struct access_dist access_dist_t;
+
+/* a choice of sizes with a weight for each, from GFAPI_RECSZ or GFAPI_FSZ */
+
+struct size_dist {
+  int count;
+  uint64_t kb[MAX_SIZE_CLASSES];
+  double cum[MAX_SIZE_CLASSES];    /* fraction of picks that go to this class or an earlier one */
+};
+typedef struct size_dist size_dist_t;
+
+/* binary I/O traces.  GFAPI_TRACE_FILE records every operation a test does, and the replay workload plays 
+ * a trace back.  a trace file is a trace_header, then rec_count trace_rec in time order, then path_count 
+ * NUL-terminated paths, relative to GFAPI_BASEDIR, which trace_rec.path_id indexes */
+
+#define TRACE_MAGIC 0x31637274     /* "trc1" */
+#define TRACE_VERSION 1
+#define TRACE_OPEN_RD 0            /* open an existing file for reading */
+#define TRACE_OPEN_WR 1            /* open for writing, creating the file if it is missing */
+#define TRACE_CREATE 2             /* create or truncate */
+#define TRACE_READ 3
+#define TRACE_WRITE 4
+#define TRACE_FSYNC 5
+#define TRACE_CLOSE 6
+#define TRACE_UNLINK 7
+#define TRACE_STAT 8
+#define TRACE_MKDIR 9
+#define TRACE_OPS 10
+static const char * trace_op_names[TRACE_OPS] = 
+   { "open-rd", "open-wr", "create", "read", "write", "fsync", "close", "unlink", "stat", "mkdir" };
+#define TRACE_MAX_LEN (1U << 30)   /* largest read or write a trace may hold, its buffer size is rounded up from this */
+#define TRACE_MAX_PATH (PATH_MAX / 2)  /* longest path a trace may hold, leaving room for GFAPI_BASEDIR */
+#define REPLAY_LATE_NS 1000000     /* a replayed operation issued more than this long after its trace time is late */
+
+struct trace_header {
+  uint32_t magic, version;
+  uint32_t rec_size;               /* sizeof(struct trace_rec), so a reader can check the layout */
+  uint32_t path_count;
+  uint64_t rec_count;
+  uint64_t duration_ns;            /* time of the last record */
+};
 
-static glfs_t * glfs_p = NULL;
+struct trace_rec {
+  uint64_t ts_ns;                  /* time since the trace started */
+  uint64_t offset;
+  uint32_t length;
+  uint32_t path_id;
+  uint8_t op;                      /* one of TRACE_* */
+  uint8_t pad[7];
+};
+typedef struct trace_rec trace_rec_t;
+
+/* paths and their ids, hashed so that looking up a path seen before is cheap */
+
+struct path_table {
+  char ** paths;
+  uint32_t count, cap;
+  uint32_t * slots;                /* id + 1 of the path hashed to each slot, 0 if empty */
+  uint32_t slot_count;             /* a power of 2, at least twice count */
+};
+typedef struct path_table path_table_t;
+
+/* operations recorded by one thread, or read by the trace importer */
+
+struct trace_buf {
+  trace_rec_t * recs;
+  uint64_t count, cap;
+  uint64_t max;                    /* records kept before the rest are dropped, 0 for no limit */
+  uint64_t dropped;
+  path_table_t paths;
+  uint32_t cur_path;               /* path_id of the file being worked on */
+};
+typedef struct trace_buf trace_buf_t;
+
+/* a trace mapped for the replay workload.  every path belongs to one thread, so its open state needs no lock */
+
+struct replay_file {
+  int fd;
+  glfs_fd_t * glfs_fd_p;
+  int opens;                       /* opens not yet closed, the file is really closed when this drops to 0 */
+  int did_read, did_write;
+};
+
+struct replay_trace {
+  struct trace_header * hdr;
+  trace_rec_t * recs;
+  char ** paths;                   /* indexed by path_id */
+  uint32_t max_len;                /* largest read or write */
+  struct replay_file * files;      /* indexed by path_id, private to each process */
+};
 
 /* shared parameter values common to all threads */
 
 struct gfapi_prm {
   int threads_per_proc;            /* threads spawned within each process */
+  int processes;                   /* worker processes forked by this program, each runs threads_per_proc threads */
+  int proc_num;                    /* which of those processes this is, 0 if not forking */
   char * workload_str;             /* name of workload to run */
   int workload_type;               /* post-parse numeric code for workload - contains WL_something */
   unsigned usec_delay_per_file;    /* microseconds of delay between each file operation */
   int recsz;                       /* I/O transfer size (KB) */
-  uint64_t filesz_kb;              /* file size (KB) */
+  uint64_t filesz_kb;              /* file size (KB), the largest one if GFAPI_FSZ is a list */
+  size_dist_t rec_dist;            /* record sizes to choose from for each I/O request */
+  size_dist_t fsz_dist;            /* file sizes to choose from for each file */
   int filecount;                   /* how many files per thread */
   uint64_t io_requests;            /* if random I/O, how many I/O requests to issue per thread */
+  uint64_t records_per_file;       /* file size divided by record size */
+  int iov;                         /* records moved by each vectored read or write call, 1 for plain calls */
+  int tree_threads;                /* prepopulate and readdir: cover the trees of this many threads */
+  int readdir_stat;                /* readdir and find: stat every entry listed */
+  unsigned readdir_bytes;          /* readdir and find on FUSE: buffer size for each getdents64 call */
+  int max_inflight;                /* rmtree and prepopulate: if non-zero, most file operations a process has outstanding */
+  int sync_mode;                   /* one of SYNC_* */
+  int o_sync;                      /* O_SYNC or O_DSYNC for files opened for writing, or 0 */
+  unsigned sync_every;             /* fsync and fdatasync modes: sync after this many records written ... */
+  unsigned sync_every_ms;          /* ... or, if non-zero, when this many milliseconds have passed since the last sync */
+  uint64_t seed;                   /* seed for per-thread random number generators */
+  char * dist_str;                 /* access distribution specification */
+  access_dist_t file_dist;         /* which file each operation picks */
+  access_dist_t offset_dist;       /* which record within a file each random I/O picks */
   int files_per_dir;               /* max files placed in each subdirectory beneath thread directory */
+  int dirs_per_dir;                /* max subdirectories placed in each directory below the top level */
+  int dir_depth;                   /* levels of directories beneath thread base directory, 1 = flat */
+  int precreate_dirs;              /* create all directories needed by a create workload before timing starts */
   float rdpct;                     /* read percentage for mixed workload */
   char * prefix;                   /* filename prefix (lets you run multiple creates in same directory) */
   char * thrd_basedir;             /* per-thread base directory */
@@ -91,23 +320,172 @@ struct gfapi_prm {
   int glfs_portnum;                /* port number (DO WE NEED?) */
   int open_flags;                  /* calculate flags to use with open or glfs_open */
   int starting_gun_timeout;        /* how long should threads wait for starting gun to fire */
+  int qdepth;                      /* I/O requests kept in flight per thread, 1 means synchronous I/O */
+  int instances;                   /* number of independent libgfapi mounts, threads are spread round-robin across them */
+  int duration;                    /* if non-zero, threads run for this many seconds instead of a fixed file count */
+  int report_interval;             /* if non-zero, print interval throughput every this many seconds */
+  int stonewall;                   /* if non-zero, record each thread's progress when the first thread finishes */
+  double target_iops;              /* if non-zero, issue I/O requests on a fixed schedule at this rate per thread */
+  double target_files_per_sec;     /* if non-zero, start files on a fixed schedule at this rate per thread */
+  int stonewall_stop;              /* if non-zero, threads also stop when the first thread finishes */
+  uint64_t warmup_ns;              /* GFAPI_WARMUP in seconds: each thread's first warmup_ns are not measured ... */
+  uint64_t warmup_ops;             /* ... or in operations: nor are its first warmup_ops operations */
+  double steady_cv;                /* if non-zero, stop once the last steady_window samples vary by less than this */
+  int steady_window;
+  int sample_ms;                   /* rate sampling interval for steady state and the confidence interval */
+  int stats_shm;                   /* if non-zero, publish live counters in /dev/shm/gfapi_perf_test.PID */
+  int * cpu_list;                  /* GFAPI_CPU_LIST, thread N is pinned to cpu_list[N % cpu_count] */
+  int cpu_count;
+  int numa_policy;                 /* one of NUMA_* */
+  int * numa_node_list;            /* for NUMA_NODES, thread N runs on and allocates from node numa_node_list[N % numa_node_count] */
+  int numa_node_count;
+  cpu_set_t event_cpus;            /* CPUs for libgfapi's own threads, empty means no restriction */
+  char * trace_file;               /* trace to record, or for the replay workload the trace to play, "" if none */
+  int trace_max_ops;               /* records each worker process keeps in memory while recording, shared among its threads */
+  double replay_speed;             /* 0 replays as fast as possible, otherwise at this multiple of the trace's own timing */
+  struct replay_trace * replay;    /* the mapped trace, for the replay workload */
+  int gen_content;                 /* if non-zero, fill each record written as compress_pct and dedupe_pct say */
+  int compress_pct;                /* percent of each 4 KB block that is zeros */
+  int dedupe_pct;                  /* percent of 4 KB blocks that repeat one of DEDUPE_BLOCKS contents */
+  int shared_layout;               /* one of SHARED_*, if not SHARED_NONE all threads do I/O to one file */
+  int shared_all_procs;            /* if non-zero, threads of all worker processes share the file, otherwise one per process */
+  int sharers;                     /* number of threads sharing the file */
+  char * shared_layout_str;
+  int phase_num;                   /* index of the current phase of a GFAPI_JOBFILE run, 0 otherwise */
+  char * phase_name;               /* name of the current phase, from its [name] line in the job file */
+  int drop_cache;                  /* if non-zero, run drop_cache_cmd before this phase starts */
+  char * drop_cache_cmd;           /* shell command that drops caches */
   int debug;                       /* debugging messages */
 };
 static struct gfapi_prm prm = {0};  /* initializer ensures everything is zero (static probably is anyway) */
+static struct gfapi_prm * phase_prm = NULL;  /* parameters of each phase, prm is set to one of these at a time */
+static int phase_count = 1;
+
+/* per-operation latency histogram, embedded in per-thread result so recording never allocates or locks */
+
+struct lat_histo {
+  uint64_t count, min_ns, max_ns;
+  uint64_t buckets[LAT_BUCKETS];
+};
+typedef struct lat_histo lat_histo_t;
+
+/* live progress counters, one per thread, each written only by its own thread with plain stores
+ * and read by the interval reporter or by an external monitor through the GFAPI_STATS_SHM segment.
+ * the segment is a live_stats_hdr followed by one live_stats per thread, so it can be read
+ * without ptrace or log parsing; bump LIVE_STATS_VERSION if this layout changes */
+
+#define LIVE_STATS_MAGIC 0x67667073  /* "gfps" */
+#define LIVE_STATS_VERSION 3
+#define LIVE_STARTING 0
+#define LIVE_RUNNING 1
+#define LIVE_DONE 2
+
+struct live_stats_hdr {
+  uint32_t magic, version;
+  int32_t pid, threads;
+  int32_t recsz_kb, state;         /* state is one of LIVE_* */
+  char workload[32];
+  int32_t phase;                   /* index of the phase now running */
+} __attribute__((aligned(CACHE_LINE)));
+
+struct live_stats {
+  uint64_t bytes, ios;
+  uint64_t files_written, files_read, files_deleted;
+  uint64_t start_ns, end_ns;       /* wall clock ns, 0 until the thread starts or finishes */
+  uint64_t metadata_ops;           /* operations done by metadata-only workloads */
+} __attribute__((aligned(CACHE_LINE)));
+typedef struct live_stats live_stats_t;
+
+static struct live_stats_hdr * live_hdr = NULL;
+static char live_shm_name[100] = {0};
+
+/* single-writer counter update, no atomic read-modify-write needed */
+
+static inline void live_add( uint64_t * counter_p, uint64_t delta )
+{
+        __atomic_store_n(counter_p, *counter_p + delta, __ATOMIC_RELAXED);
+}
+
+static inline uint64_t live_get( uint64_t * counter_p )
+{
+        return __atomic_load_n(counter_p, __ATOMIC_RELAXED);
+}
+
+/* CPU time and scheduling counts used during the timed part of a test, from getrusage() */
+
+struct cpu_usage {
+  double user_sec, sys_sec;
+  uint64_t nvcsw, nivcsw;          /* voluntary and involuntary context switches */
+  uint64_t minflt, majflt;         /* page faults */
+};
+typedef struct cpu_usage cpu_usage_t;
 
 /* per-thread data structure */
 
 struct gfapi_result {
   pthread_t thr;
   int thread_num;
+  int instance;                    /* which glfs_instances[] entry this thread uses, -1 for aggregates */
+  glfs_t * fs;
+  live_stats_t * live;             /* this thread's live counters */
   uint64_t elapsed_time, end_time, start_time;
+  uint64_t last_start_time;        /* for aggregates, latest start_time, used to compute start skew */
+  uint64_t min_elapsed, max_elapsed;  /* shortest and longest thread completion time */
+  int sw_taken;                    /* stonewall snapshot below has been recorded */
+  uint64_t sw_bytes, sw_ios, sw_files, sw_elapsed;  /* progress when the first thread finished */
+  double sw_mbps, sw_iops, sw_fps;    /* rates up to the stonewall, summed over threads in aggregates */
+  uint64_t paced_ops, late_ops, max_lag_ns;  /* open-loop schedule: ops issued, ops issued more than one interval late, worst lateness */
+  uint64_t pace_sleep_ns;          /* time spent waiting for paced ops to come due */
   uint64_t total_bytes_xferred, total_io_count;
+  uint64_t io_calls;               /* vectored read and write calls, each moving up to GFAPI_IOV records */
   uint64_t files_read, files_written, files_deleted;
-};
+  uint64_t metadata_ops;
+  uint64_t dirs_created;           /* directories made before the timed phase, or by prepopulate */
+  uint64_t dirs_removed;           /* rmtree: directories removed */
+  uint64_t tree_tasks, tree_steals;  /* tree workloads: directories done, and how many were taken from another thread */
+  uint64_t entries_listed;         /* readdir and find: directory entries returned, not counting . and .. */
+  uint64_t dirsz_dirs[DIRSZ_CLASSES];     /* readdir and find: directories listed in each size class */
+  uint64_t dirsz_entries[DIRSZ_CLASSES];  /* ... their entries */
+  uint64_t dirsz_ns[DIRSZ_CLASSES];       /* ... and the time spent listing them */
+  uint64_t deadline_ns;            /* monotonic time at which a GFAPI_DURATION run stops, 0 if none */
+  int warming;                     /* GFAPI_WARMUP is not over yet for this thread, in aggregates the number of 
+                                    * threads that finished before their warm-up did */
+  uint64_t warm_end_ns;            /* monotonic time at which a timed warm-up ends */
+  uint64_t warm_done_ns;           /* monotonic time at which the warm-up did end, file phases are timed from here */
+  struct rusage ru_start;          /* thread usage when measurement started */
+  int start_cpu, buf_node;         /* CPU the thread started on and NUMA node of its buffer, -1 if unknown */
+  char allowed_cpus[64];           /* CPUs the thread may run on, as a list */
+  uint64_t rec_class_ios[MAX_SIZE_CLASSES];    /* I/O requests in each record size class */
+  uint64_t rec_class_bytes[MAX_SIZE_CLASSES];
+  uint64_t fsz_class_files[MAX_SIZE_CLASSES];  /* files done in each file size class */
+  uint64_t thread_ns;              /* elapsed time of this thread, summed over threads in aggregates */
+  uint64_t file_phase_ns[FILE_PHASES];     /* time spent in each FILE_PHASE_* */
+  uint64_t file_phase_count[FILE_PHASES];  /* files that went through each phase */
+  trace_buf_t * trace;             /* operations recorded for GFAPI_TRACE_FILE, NULL if not recording */
+  uint64_t * replay_idx;           /* indexes of the trace records this thread replays */
+  uint64_t replay_count;
+  uint64_t lag_sum_ns;             /* replay: total lateness of operations issued after their trace time */
+  uint64_t replay_errors;          /* replayed operations that failed, e.g. reads of a file that is not here */
+  cpu_usage_t cpu;                 /* used by this worker thread, or summed over worker threads */
+  cpu_usage_t proc_cpu;            /* used by whole processes, including libgfapi event threads, in aggregates only */
+  lat_histo_t lat[OP_TYPES];       /* one latency histogram per OP_* type */
+} __attribute__((aligned(CACHE_LINE)));
 typedef struct gfapi_result gfapi_result_t;
 
 
 
+/* memory shared by all worker processes forked with GFAPI_PROCESSES, mapped before fork */
+
+struct proc_shared {
+  pthread_barrier_t start_barrier; /* every thread of every process waits here, so they all start together */
+  pthread_barrier_t phase_barrier; /* every process waits here between phases */
+  uint64_t stonewall_ns;           /* wall clock time at which the first thread finished, 0 until then */
+  uint64_t steady_ns;              /* wall clock time at which a process reached steady state, 0 until then */
+  gfapi_result_t proc_results[];   /* aggregate result of each process in each phase, indexed by phase * processes + process */
+};
+static struct proc_shared * proc_shared = NULL;
+static struct rusage proc_ru_start;  /* process usage when this process's threads were released */
+
 /*** code begins here ****/
 
 char * now_str(void) {
@@ -121,10 +499,13 @@ char * now_str(void) {
 
 /* if system call error occurs, call this to print errno and then exit */
 
-void scallerr(char * msg)
+void scallerr(const char * msg)
 {
+        int j;
+
         printf("%s : %s : errno (%d)%s\n", now_str(), msg, errno, strerror(errno));
-        if (glfs_p) glfs_fini(glfs_p);
+        if (glfs_instances) FOREACH(j, prm.instances) if (glfs_instances[j]) glfs_fini(glfs_instances[j]);
+        if (live_shm_name[0]) shm_unlink(live_shm_name);
         exit(NOTOK); 
 }
 
@@ -142,15 +523,21 @@ void usage2(const char * msg, const char * param)
         puts("GFAPI_HOSTNAME          - Gluster server participating in the volume");
         puts("GFAPI_TRANSPORT (tcp)   - transport protocol to use, can be tcp or rdma");
         puts("GFAPI_PORT (24007)      - port number to connect to");
-        puts("GFAPI_RECSZ (64)        - I/O transfer size (i.e. record size) to use");
-        puts("GFAPI_FSZ (1M)          - file size ");
+        puts("GFAPI_RECSZ (64)        - I/O transfer size (i.e. record size) to use, or a mix like 4k:60,64k:30,1m:10");
+        puts("GFAPI_FSZ (1M)          - file size, or for sequential workloads a mix like 4k:50,1m:50 ");
         puts("GFAPI_BASEDIR(/tmp)     - directory for this thread to use");
-        puts("GFAPI_LOAD (seq-wr)     - workload to apply, can be one of seq-wr, seq-rd, rnd-wr, rnd-rd, unlink, seq-rdwrmix");
+        puts("GFAPI_LOAD (seq-wr)     - workload to apply, can be one of seq-wr, seq-rd, rnd-wr, rnd-rd, unlink, seq-rdwrmix,");
+        puts("                          or metadata-only stat, chmod, getxattr, setxattr, rename, create, mkdir, ls-l,");
+        puts("                          or replay to play back GFAPI_TRACE_FILE,");
+        puts("                          or rmtree or prepopulate to remove or fill the whole tree with work-stealing threads,");
+        puts("                          or readdir or find to list its leaf directories or every directory in it");
         puts("GFAPI_IOREQ (0 = all)   - for random workloads , how many requests to issue");
         puts("GFAPI_DIRECT (0 = off)  - force use of O_DIRECT even for sequential reads/writes");
         puts("GFAPI_FUSE (0 = false)  - if true, use POSIX (through FUSE) instead of libgfapi");
         puts("GFAPI_TRCLVL (0 = none) - trace level specified in glfs_set_logging");
         puts("GFAPI_FILES (100)       - number of files to access");
+        puts("GFAPI_THREADS_PER_PROC (1) - number of threads in each process");
+        puts("GFAPI_PROCESSES (1)     - fork this many worker processes, all threads in all of them start together");
         puts("GFAPI_STARTING_GUN (none) - touch this file to begin test after all processes are started");
         puts("GFAPI_STARTING_GUN_TIMEOUT (60) - each thread waits this many seconds for starting gun file before timing out");
         puts("GFAPI_FILES_PER_DIR (1000) - maximum files placed in a leaf directory");
@@ -159,7 +546,47 @@ void usage2(const char * msg, const char * param)
         puts("GFAPI_PREFIX (none)     - insert string in front of filename");
         puts("GFAPI_USEC_DELAY_PER_FILE (0) - if non-zero, then sleep this many microseconds after each file is accessed");
         puts("GFAPI_FSYNC_AT_CLOSE (0) - if 1, then issue fsync() call on file before closing");
-        /* puts("GFAPI_DIRS_PER_DIR (1000) - maximum subdirs placed in a directory"); */
+        puts("GFAPI_SYNC_MODE (none)  - fsync or fdatasync every GFAPI_SYNC_EVERY, or osync or odsync to open files with O_SYNC or O_DSYNC");
+        puts("GFAPI_SYNC_EVERY (1)    - for fsync and fdatasync, sync after this many records written, or a time like 10ms");
+        puts("GFAPI_QDEPTH (1)        - if > 1, keep this many async I/O requests in flight per thread");
+        puts("GFAPI_IOV (1)           - if > 1, read or write this many records per call with readv/writev or preadv/pwritev");
+        puts("GFAPI_INSTANCES (1)     - number of libgfapi mounts (glfs_t) per process, threads are spread round-robin across them");
+        puts("GFAPI_DURATION (0)      - if non-zero, each thread runs this many seconds, GFAPI_FILES is then the set of files reused");
+        puts("GFAPI_SEED (time)       - seed for random offsets and read/write mix, reuse it to repeat the same sequence");
+        puts("GFAPI_DIST (none)       - uniform, zipf:theta or hotspot:data-pct/access-pct, skews choice of files and random offsets");
+        puts("GFAPI_REPORT_INTERVAL (0) - if non-zero, print aggregate and per-thread throughput every this many seconds");
+        puts("GFAPI_TARGET_IOPS (0)   - if non-zero, issue I/O requests on a fixed schedule at this rate per thread, latency counts from scheduled time");
+        puts("GFAPI_TARGET_FILES_PER_SEC (0) - if non-zero, start files on a fixed schedule at this rate per thread");
+        puts("GFAPI_TARGET_PER_PROC (0) - if 1, target rates are per process and are split across its threads");
+        puts("GFAPI_STONEWALL (0)     - if 1, also report throughput measured only while all threads were running");
+        puts("GFAPI_STONEWALL_STOP (0) - if 1, stonewall and stop all threads as soon as the first one finishes");
+        puts("GFAPI_WARMUP (0)        - seconds, or operations like 1000ops, at the start of each thread that are not measured");
+        puts("GFAPI_STEADY_CV (0)     - if non-zero, stop once the last GFAPI_STEADY_WINDOW rate samples vary by less than this CoV");
+        puts("GFAPI_STEADY_WINDOW (10) - number of rate samples the steady-state test looks at");
+        puts("GFAPI_SAMPLE_MS (1000)  - with GFAPI_WARMUP or GFAPI_STEADY_CV, sample the rate this often for a confidence interval");
+        puts("GFAPI_STATS_SHM (0)     - if 1, publish live per-thread counters in /dev/shm/gfapi_perf_test.PID while running");
+        puts("GFAPI_DIR_DEPTH (1)     - levels of directories per thread, 1 puts all leaf directories in one level");
+        puts("GFAPI_DIRS_PER_DIR (1000) - maximum subdirs placed in a directory below the top level, if GFAPI_DIR_DEPTH > 1");
+        puts("GFAPI_PRECREATE_DIRS (1) - for create workloads, make all directories before the timed phase starts");
+        puts("GFAPI_TREE_THREADS (all) - prepopulate makes the files that this many threads would have written, readdir lists them");
+        puts("GFAPI_MAX_INFLIGHT (0)  - if non-zero, rmtree and prepopulate keep at most this many file operations in flight per process");
+        puts("GFAPI_READDIR_STAT (0)  - if 1, readdir and find also stat every entry they list");
+        puts("GFAPI_READDIR_KB (32)   - readdir and find on FUSE list directories with getdents64 into a buffer of this size");
+        puts("GFAPI_CPU_LIST (none)   - pin worker thread N to the Nth cpu in this list, like 0-3,8");
+        puts("GFAPI_NUMA_POLICY (default) - local or nodes:list, keep each thread and its buffer on one NUMA node");
+        puts("GFAPI_EVENT_CPU_LIST (none) - pin the threads that libgfapi starts to these cpus");
+        puts("GFAPI_COMPRESS_PCT (none) - fill written records so this percent of each 4 KB block compresses away");
+        puts("GFAPI_DEDUPE_PCT (none) - fill written records so this percent of 4 KB blocks are duplicates");
+        puts("GFAPI_SHARED_FILE (none) - strided, blocked or random: all threads do I/O to one file of size GFAPI_FSZ");
+        puts("GFAPI_SHARED_SCOPE (all) - all threads in all processes share one file, or process for one file per process");
+        puts("GFAPI_TRACE_FILE (none) - record every operation of the test in this binary trace, or the trace to replay");
+        puts("GFAPI_REPLAY_SPEED (0)  - 0 replays as fast as possible, otherwise at this multiple of the trace's timing");
+        puts("GFAPI_TRACE_MAX_OPS (4194304) - operations each worker process records at most, shared equally by its threads");
+        puts("GFAPI_TRACE_IMPORT (none) - convert this strace -f -ttt log or text trace to GFAPI_TRACE_FILE and exit");
+        puts("GFAPI_TRACE_STRIP (none) - prefix such as the mountpoint to remove from imported paths, others are dropped");
+        puts("GFAPI_JOBFILE (none)    - run the phases listed in this file one after another, on the same mount");
+        puts("GFAPI_DROP_CACHE (0)    - if 1, run GFAPI_DROP_CACHE_CMD before starting the test or phase");
+        puts("GFAPI_DROP_CACHE_CMD (sync; echo 3 > /proc/sys/vm/drop_caches) - shell command that drops caches");
         exit(NOTOK);
 }
 
@@ -187,41 +614,79 @@ float getenv_float( const char * env_var, const float default_value)
         return val;
 }
 
-/* get an integer file size environment variable, returning default value if undefined */
+/* convert a size like 64, 4k, 1m or 2g to KB, a number without a suffix is already in KB */
 
-uint64_t getenv_size64_kb( const char * env_var, const uint64_t default_value)
+uint64_t parse_size_kb( const char * str )
 {
-        char * str_val = getenv(env_var);
-        uint64_t val = default_value;
-        int slen;
-        if (str_val) {
-          slen = strlen(str_val);
-          if (slen > 0) {
-            char lastch = str_val[slen-1];
-            val = atoi(str_val);
-            if (isalpha(lastch)) {
-              str_val[slen-1] = 0; /* drop the unit */
-              switch (toupper(lastch)) {
-                case 'M':
-                  val *= KB_PER_MB;
-                  break;
-                case 'K':
-                  break;
-                case 'G':
-                  val *= (KB_PER_MB * KB_PER_MB);
-                  break;
-                case 'T':
-                  val *= (KB_PER_MB * KB_PER_MB * KB_PER_MB);
-                  break;
-                default:
-                  usage("use lower- or upper-case suffixes K, M, G, or T for file size");
-              }
+        uint64_t val = strtoull(str, NULL, 10);
+        int slen = strlen(str);
+        if (slen > 0) {
+          char lastch = str[slen-1];
+          if (isalpha(lastch)) {
+            switch (toupper(lastch)) {
+              case 'M':
+                val *= KB_PER_MB;
+                break;
+              case 'K':
+                break;
+              case 'G':
+                val *= (KB_PER_MB * KB_PER_MB);
+                break;
+              case 'T':
+                val *= (KB_PER_MB * KB_PER_MB * KB_PER_MB);
+                break;
+              default:
+                usage("use lower- or upper-case suffixes K, M, G, or T for file size");
             }
           }
         }
         return val;
 }
 
+/* parse a size, or a list of size:percent pairs like 4k:60,64k:30,1m:10, from an environment variable */
+
+void size_dist_parse( const char * env_var, const char * str, size_dist_t * d )
+{
+        char copy[1024], * tok, * save = NULL, * colon;
+        double weight, total = 0.0;
+        int j;
+
+        if (strlen(str) >= sizeof(copy)) usage2("%s is too long", env_var);
+        strcpy(copy, str);
+        d->count = 0;
+        for (tok = strtok_r(copy, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+          if (d->count == MAX_SIZE_CLASSES) usage2("%s has too many size classes", env_var);
+          colon = strchr(tok, ':');
+          if (colon) *colon = 0;
+          d->kb[d->count] = parse_size_kb(tok);
+          if (d->kb[d->count] == 0) usage2("%s sizes must be at least 1 KB", env_var);
+          weight = colon ? atof(colon + 1) : 1.0;
+          if (weight <= 0.0) usage2("%s percentages must be greater than zero", env_var);
+          total += weight;
+          d->cum[d->count++] = total;
+        }
+        if (d->count == 0) usage2("%s is empty", env_var);
+        if (d->count > 1 && !strchr(str, ':')) usage2("%s needs size:percent for each size class", env_var);
+        FOREACH(j, d->count) d->cum[j] /= total;
+}
+
+static inline int size_dist_pick( size_dist_t * d, double u )
+{
+        int j;
+
+        for (j = 0; j < d->count - 1; j++) if (u < d->cum[j]) break;
+        return j;
+}
+
+uint64_t size_dist_max( size_dist_t * d )
+{
+        uint64_t max = 0;
+        int j;
+
+        FOREACH(j, d->count) if (d->kb[j] > max) max = d->kb[j];
+        return max;
+}
+
 /* get a string environment variable, returning default value if undefined */
 
 char * getenv_str( const char * env_var, const char * default_value)
@@ -247,6 +712,108 @@ uint64_t gettime_ns(void)
         return ns;
 }
 
+/* get monotonic time in nanosec, used for per-operation latencies */
+
+uint64_t getmono_ns(void)
+{
+        struct timespec t;
+
+        clock_gettime(CLOCK_MONOTONIC, &t);
+        return t.tv_nsec + 1000000000ULL*t.tv_sec;
+}
+
+/* map a latency to its histogram bucket */
+
+static inline unsigned lat_bucket( uint64_t ns )
+{
+        unsigned msb, shift;
+
+        if (ns < LAT_SUB_BUCKETS) return (unsigned )ns;
+        if (ns >> LAT_MAX_BITS) ns = (1ULL << LAT_MAX_BITS) - 1;
+        msb = 63 - __builtin_clzll(ns);
+        shift = msb - LAT_SUB_BITS;
+        return (shift + 1) * LAT_SUB_BUCKETS + ((ns >> shift) & (LAT_SUB_BUCKETS - 1));
+}
+
+/* map a histogram bucket back to the midpoint of the latency range it covers */
+
+uint64_t lat_bucket_value( unsigned idx )
+{
+        unsigned shift, sub;
+
+        if (idx < LAT_SUB_BUCKETS) return idx;
+        shift = idx / LAT_SUB_BUCKETS - 1;
+        sub = idx % LAT_SUB_BUCKETS;
+        return ((uint64_t )(LAT_SUB_BUCKETS + sub) << shift) + ((1ULL << shift) >> 1);
+}
+
+/* record one operation that took ns nanoseconds */
+
+static inline void lat_record_ns( lat_histo_t * h, uint64_t ns )
+{
+        if (h->count == 0 || ns < h->min_ns) h->min_ns = ns;
+        if (ns > h->max_ns) h->max_ns = ns;
+        h->count++;
+        h->buckets[lat_bucket(ns)]++;
+}
+
+/* record one operation that started at start_ns, returns the current time for chaining */
+
+static inline uint64_t lat_record( lat_histo_t * h, uint64_t start_ns )
+{
+        uint64_t now = getmono_ns();
+
+        lat_record_ns(h, now - start_ns);
+        return now;
+}
+
+/* merge histogram in into histogram out */
+
+void lat_merge( lat_histo_t * in, lat_histo_t * out )
+{
+        unsigned j;
+
+        if (in->count == 0) return;
+        if (out->count == 0 || in->min_ns < out->min_ns) out->min_ns = in->min_ns;
+        if (in->max_ns > out->max_ns) out->max_ns = in->max_ns;
+        out->count += in->count;
+        FOREACH(j, LAT_BUCKETS) out->buckets[j] += in->buckets[j];
+}
+
+/* return latency at percentile pct (0-100), clamped to observed min and max */
+
+uint64_t lat_percentile( lat_histo_t * h, double pct )
+{
+        unsigned j;
+        uint64_t seen = 0, v;
+        uint64_t target = (uint64_t )ceil(h->count * pct / 100.0);
+
+        if (target < 1) target = 1;
+        FOREACH(j, LAT_BUCKETS) {
+                seen += h->buckets[j];
+                if (seen >= target) break;
+        }
+        v = lat_bucket_value(j);
+        if (v < h->min_ns) v = h->min_ns;
+        if (v > h->max_ns) v = h->max_ns;
+        return v;
+}
+
+void print_latencies( gfapi_result_t * result_p )
+{
+        int op;
+
+        FOREACH(op, OP_TYPES) {
+                lat_histo_t * h = &result_p->lat[op];
+                if (h->count == 0) continue;
+                printf("  %-8s latency usec: count "UINT64DFMT" (%.1f/sec) min %.1f p50 %.1f p90 %.1f p99 %.1f p99.9 %.1f max %.1f\n",
+                        op_names[op], h->count, h->count * NSEC_PER_SEC / result_p->elapsed_time, h->min_ns/1000.0,
+                        lat_percentile(h, 50.0)/1000.0, lat_percentile(h, 90.0)/1000.0,
+                        lat_percentile(h, 99.0)/1000.0, lat_percentile(h, 99.9)/1000.0,
+                        h->max_ns/1000.0);
+        }
+}
+
 void sleep_for_usec( unsigned usec_delay_per_file )
 {
      int rc;
@@ -256,31 +823,2202 @@ void sleep_for_usec( unsigned usec_delay_per_file )
      if (rc < OK) scallerr("select");
 }
 
-/* used to generate random offsets into a file for random I/O workloads */
+/* per-thread random number generator (splitmix64), so threads never share state or take a lock */
+
+static inline uint64_t rnd_next( uint64_t * state_p )
+{
+        uint64_t z = (*state_p += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+}
+
+/* uniform random double in [0, 1) */
+
+static inline double rnd_double( uint64_t * state_p )
+{
+        return (rnd_next(state_p) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/* parse GFAPI_DIST, one of uniform, zipf:theta or hotspot:data-pct/access-pct */
+
+void dist_parse( const char * str, access_dist_t * d )
+{
+        double a, b;
+
+        memset(d, 0, sizeof(*d));
+        if (strlen(str) == 0) {
+          d->type = DIST_NONE;
+        } else if (strcmp(str, "uniform") == 0) {
+          d->type = DIST_UNIFORM;
+        } else if (sscanf(str, "zipf:%lf", &a) == 1) {
+          if (a <= 0.0 || a >= 1.0) usage2("zipf theta must be between 0 and 1 exclusive: %s", str);
+          d->type = DIST_ZIPF;
+          d->theta = a;
+        } else if (sscanf(str, "hotspot:%lf/%lf", &a, &b) == 2) {
+          if (a <= 0.0 || a >= 100.0 || b < 0.0 || b > 100.0) 
+            usage2("hotspot percentages must be between 0 and 100: %s", str);
+          d->type = DIST_HOTSPOT;
+          d->hot_data_frac = a / 100.0;
+          d->hot_access_frac = b / 100.0;
+        } else {
+          usage2("GFAPI_DIST must be uniform, zipf:theta or hotspot:data-pct/access-pct, not %s", str);
+        }
+}
+
+/* generalized harmonic number sum(i^-theta, i=1..n), summed exactly for the first
+ * million terms and with the Euler-Maclaurin approximation beyond that, so huge files start quickly */
+
+#define ZETA_EXACT_TERMS 1000000
+
+double zeta( uint64_t n, double theta )
+{
+        uint64_t i, m = n < ZETA_EXACT_TERMS ? n : ZETA_EXACT_TERMS;
+        double sum = 0.0;
+
+        for (i = 1; i <= m; i++) sum += pow((double )i, -theta);
+        if (n > m) {
+          sum += (pow((double )n, 1.0 - theta) - pow((double )m, 1.0 - theta)) / (1.0 - theta);
+          sum += (pow((double )n, -theta) - pow((double )m, -theta)) / 2.0;
+        }
+        return sum;
+}
+
+/* set up distribution d to choose among n items, zipf constants follow Gray et al., "Quickly generating billion-record synthetic databases" */
+
+void dist_init( access_dist_t * d, uint64_t n )
+{
+        d->n = n;
+        if (d->type == DIST_ZIPF) {
+          double zeta2 = zeta(2, d->theta);
+          d->alpha = 1.0 / (1.0 - d->theta);
+          d->zetan = zeta(n, d->theta);
+          d->eta = (1.0 - pow(2.0 / n, 1.0 - d->theta)) / (1.0 - zeta2 / d->zetan);
+          d->half_pow_theta = 1.0 + pow(0.5, d->theta);
+        }
+}
+
+/* pick next item index in [0, n), for zipf index 0 is the most popular, for hotspot the hot items come first */
+
+static inline uint64_t dist_next( access_dist_t * d, uint64_t * state_p )
+{
+        double u = rnd_double(state_p);
+        uint64_t hot_count, v;
+
+        switch (d->type) {
+          case DIST_ZIPF:
+            if (u * d->zetan < 1.0) return 0;
+            if (u * d->zetan < d->half_pow_theta) return d->n > 1 ? 1 : 0;
+            v = (uint64_t )(d->n * pow(d->eta * u - d->eta + 1.0, d->alpha));
+            return v < d->n ? v : d->n - 1;
+          case DIST_HOTSPOT:
+            hot_count = (uint64_t )(d->n * d->hot_data_frac);
+            if (hot_count < 1) hot_count = 1;
+            if (hot_count >= d->n) return rnd_next(state_p) % d->n;
+            if (u < d->hot_access_frac) return rnd_next(state_p) % hot_count;
+            return hot_count + rnd_next(state_p) % (d->n - hot_count);
+          default:
+            return rnd_next(state_p) % d->n;
+        }
+}
+
+/* used to generate random offsets into a file for random I/O workloads
+ * a 4-round Feistel network is a bijection over [0, 2^bits), and cycle-walking
+ * until the result is below record_count turns it into a permutation of record indexes,
+ * so every record is visited once per pass in constant memory */
+
+#define PERM_ROUNDS 4
+
+struct offset_perm {
+  uint64_t record_count;
+  unsigned half_bits;
+  uint64_t half_mask;
+  uint64_t keys[PERM_ROUNDS];
+};
+typedef struct offset_perm offset_perm_t;
+
+void offset_perm_init( offset_perm_t * perm, uint64_t record_count, uint64_t seed )
+{
+        unsigned bits = 2, j;
+
+        while (bits < 64 && (1ULL << bits) < record_count) bits += 2;
+        perm->record_count = record_count;
+        perm->half_bits = bits / 2;
+        perm->half_mask = (1ULL << perm->half_bits) - 1;
+        FOREACH(j, PERM_ROUNDS) perm->keys[j] = rnd_next(&seed);
+}
 
-off_t * random_offset_sequence( uint64_t file_size_bytes, size_t record_size_bytes )
+static inline off_t random_offset( offset_perm_t * perm, uint64_t index )
 {
+        uint64_t x = index, left, right, f;
         unsigned j;
-        uint64_t io_requests = file_size_bytes / record_size_bytes;
-        off_t * offset_sequence = (off_t * )calloc(io_requests, sizeof(off_t));
 
-        for (j=0; j<io_requests; j++) offset_sequence[j] = j*record_size_bytes;
-        for (j=0; j<io_requests; j++) {
-                off_t next_offset = offset_sequence[j];
-                unsigned random_index = random() % io_requests;
-                off_t random_offset = offset_sequence[random_index];
-                offset_sequence[j] = random_offset;
-                offset_sequence[random_index] = next_offset;
+        do {
+          left = x >> perm->half_bits;
+          right = x & perm->half_mask;
+          FOREACH(j, PERM_ROUNDS) {
+            f = (right ^ perm->keys[j]) * 0x9e3779b97f4a7c15ULL;
+            f = (f ^ (f >> 29)) & perm->half_mask;
+            f ^= left;
+            left = right;
+            right = f;
+          }
+          x = (left << perm->half_bits) | right;
+        } while (x >= perm->record_count);
+        return (off_t )x * prm.bytes_to_xfer;
+}
+
+/* offset of the index-th random I/O, with GFAPI_DIST the record index is drawn from the distribution
+ * and then permuted, so hot records are scattered through the file rather than bunched at its start */
+
+static inline off_t next_random_offset( offset_perm_t * perm, uint64_t index, uint64_t * rnd_state_p )
+{
+        if (prm.offset_dist.type != DIST_NONE) index = dist_next(&prm.offset_dist, rnd_state_p);
+        return random_offset(perm, index);
+}
+
+/* asynchronous I/O engine, used when GFAPI_QDEPTH > 1 
+ * each thread has its own context, with one buffer slot per in-flight request
+ * libgfapi completions arrive on gfapi event threads, so they are handed back to the worker through a small ring
+ * POSIX completions come from a per-thread io_uring driven directly with syscalls, so there is no extra library */
+
+struct uring {
+  int ring_fd;
+  unsigned * sq_tail, * sq_mask, * sq_array;
+  unsigned * cq_head, * cq_tail, * cq_mask;
+  struct io_uring_sqe * sqes;
+  struct io_uring_cqe * cqes;
+  char * sq_ptr, * cq_ptr;
+  size_t sq_sz, cq_sz, sqes_sz;
+};
+
+struct aio_ctx;
+
+struct aio_slot {
+  struct aio_ctx * ctx;
+  char * buf;
+  uint64_t submit_ns;
+  unsigned len;
+  int size_class;                  /* index into prm.rec_dist */
+  ssize_t ret;
+  int err;                         /* errno of a failed request, which happened in another thread for libgfapi */
+};
+
+struct aio_ctx {
+  int qdepth;
+  struct aio_slot * slots;
+  int * free_slots;                /* stack of idle slot indexes */
+  int nfree;
+  pthread_mutex_t lock;            /* protects done_ring, filled by libgfapi callbacks */
+  pthread_cond_t done_cv;
+  int * done_ring;
+  unsigned done_head, done_tail;
+  struct uring ring;
+};
+typedef struct aio_ctx aio_ctx_t;
+
+void uring_init( struct uring * r, unsigned entries )
+{
+        struct io_uring_params p = {0};
+        size_t sq_sz, cq_sz;
+        char * sq_ptr, * cq_ptr;
+
+        r->ring_fd = syscall(__NR_io_uring_setup, entries, &p);
+        if (r->ring_fd < OK) scallerr("io_uring_setup");
+        sq_sz = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+        cq_sz = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+        if (p.features & IORING_FEAT_SINGLE_MMAP) {
+          if (cq_sz > sq_sz) sq_sz = cq_sz;
+        }
+        sq_ptr = mmap(NULL, sq_sz, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, r->ring_fd, IORING_OFF_SQ_RING);
+        if (sq_ptr == MAP_FAILED) scallerr("mmap io_uring sq ring");
+        if (p.features & IORING_FEAT_SINGLE_MMAP) {
+          cq_ptr = sq_ptr;
+        } else {
+          cq_ptr = mmap(NULL, cq_sz, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, r->ring_fd, IORING_OFF_CQ_RING);
+          if (cq_ptr == MAP_FAILED) scallerr("mmap io_uring cq ring");
+        }
+        r->sqes_sz = p.sq_entries * sizeof(struct io_uring_sqe);
+        r->sqes = mmap(NULL, r->sqes_sz, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, r->ring_fd, IORING_OFF_SQES);
+        if (r->sqes == MAP_FAILED) scallerr("mmap io_uring sqes");
+        r->sq_tail = (unsigned * )(sq_ptr + p.sq_off.tail);
+        r->sq_mask = (unsigned * )(sq_ptr + p.sq_off.ring_mask);
+        r->sq_array = (unsigned * )(sq_ptr + p.sq_off.array);
+        r->cq_head = (unsigned * )(cq_ptr + p.cq_off.head);
+        r->cq_tail = (unsigned * )(cq_ptr + p.cq_off.tail);
+        r->cq_mask = (unsigned * )(cq_ptr + p.cq_off.ring_mask);
+        r->cqes = (struct io_uring_cqe * )(cq_ptr + p.cq_off.cqes);
+        r->sq_ptr = sq_ptr;
+        r->sq_sz = sq_sz;
+        r->cq_ptr = cq_ptr;
+        r->cq_sz = cq_sz;
+}
+
+void uring_fini( struct uring * r )
+{
+        munmap(r->sqes, r->sqes_sz);
+        if (r->cq_ptr != r->sq_ptr) munmap(r->cq_ptr, r->cq_sz);
+        munmap(r->sq_ptr, r->sq_sz);
+        close(r->ring_fd);
+}
+
+void uring_submit( struct uring * r, int opcode, int fd, void * buf, unsigned len, off_t offset, uint64_t user_data )
+{
+        unsigned tail = *r->sq_tail;
+        unsigned idx = tail & *r->sq_mask;
+        struct io_uring_sqe * sqe = &r->sqes[idx];
+
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = opcode;
+        sqe->fd = fd;
+        sqe->addr = (uint64_t )(uintptr_t )buf;
+        sqe->len = len;
+        sqe->off = offset;
+        sqe->user_data = user_data;
+        r->sq_array[idx] = idx;
+        __atomic_store_n(r->sq_tail, tail + 1, __ATOMIC_RELEASE);
+        if (syscall(__NR_io_uring_enter, r->ring_fd, 1, 0, 0, NULL, 0) < OK) scallerr("io_uring_enter");
+}
+
+/* block until a completion is available, return its user_data and store its result in *res_p */
+
+uint64_t uring_reap( struct uring * r, ssize_t * res_p )
+{
+        unsigned head, tail;
+        struct io_uring_cqe * cqe;
+        uint64_t user_data;
+
+        for (;;) {
+          head = *r->cq_head;
+          tail = __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE);
+          if (head != tail) break;
+          if (syscall(__NR_io_uring_enter, r->ring_fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0) < OK && errno != EINTR)
+            scallerr("io_uring_enter");
         }
-        return offset_sequence;
+        cqe = &r->cqes[head & *r->cq_mask];
+        user_data = cqe->user_data;
+        *res_p = cqe->res;
+        __atomic_store_n(r->cq_head, head + 1, __ATOMIC_RELEASE);
+        return user_data;
 }
 
-/* compute next pathname for thread to use */
+/* libgfapi completion callback, runs in a gfapi event thread */
 
-void get_next_path( const int filenum, const int files_per_dir, const int thread_num, const char * base_dir, const char * prefix, char *next_fname  )
+void aio_glfs_cbk( glfs_fd_t * fd, ssize_t ret, void * data )
+{
+        struct aio_slot * slot = (struct aio_slot * )data;
+        aio_ctx_t * ctx = slot->ctx;
+
+        pthread_mutex_lock(&ctx->lock);
+        slot->ret = ret;
+        slot->err = (ret < 0) ? errno : 0;
+        ctx->done_ring[ctx->done_tail++ % ctx->qdepth] = slot - ctx->slots;
+        pthread_cond_signal(&ctx->done_cv);
+        pthread_mutex_unlock(&ctx->lock);
+}
+
+void aio_init( aio_ctx_t * ctx, int qdepth, char * buf )
+{
+        int j;
+
+        ctx->qdepth = qdepth;
+        ctx->slots = (struct aio_slot * )calloc(qdepth, sizeof(struct aio_slot));
+        ctx->free_slots = (int * )calloc(qdepth, sizeof(int));
+        ctx->done_ring = (int * )calloc(qdepth, sizeof(int));
+        if (!ctx->slots || !ctx->free_slots || !ctx->done_ring) scallerr("calloc aio context");
+        FOREACH(j, qdepth) {
+          ctx->slots[j].ctx = ctx;
+          ctx->slots[j].buf = buf + (size_t )j * prm.bytes_to_xfer;
+          ctx->free_slots[j] = j;
+        }
+        ctx->nfree = qdepth;
+        ctx->done_head = ctx->done_tail = 0;
+        pthread_mutex_init(&ctx->lock, NULL);
+        pthread_cond_init(&ctx->done_cv, NULL);
+        if (prm.use_fuse) uring_init(&ctx->ring, qdepth);
+}
+
+/* release what aio_init allocated, threads are started again for each phase of a job file */
+
+void aio_fini( aio_ctx_t * ctx )
+{
+        if (prm.use_fuse) uring_fini(&ctx->ring);
+        pthread_cond_destroy(&ctx->done_cv);
+        pthread_mutex_destroy(&ctx->lock);
+        free(ctx->slots);
+        free(ctx->free_slots);
+        free(ctx->done_ring);
+}
+
+/* the buffer that the next aio_submit() will use */
+
+static inline char * aio_next_buf( aio_ctx_t * ctx )
+{
+        return ctx->slots[ctx->free_slots[ctx->nfree - 1]].buf;
+}
+
+void aio_submit( aio_ctx_t * ctx, int is_write, int fd, glfs_fd_t * glfs_fd_p, off_t offset, unsigned len, int size_class )
+{
+        struct aio_slot * slot = &ctx->slots[ctx->free_slots[--ctx->nfree]];
+        int rc;
+
+        slot->submit_ns = getmono_ns();
+        slot->len = len;
+        slot->size_class = size_class;
+        if (prm.use_fuse) {
+          uring_submit(&ctx->ring, is_write ? IORING_OP_WRITE : IORING_OP_READ, fd, 
+                       slot->buf, len, offset, slot - ctx->slots);
+        } else {
+          rc = is_write ?
+            glfs_pwrite_async(glfs_fd_p, slot->buf, len, offset, 0, aio_glfs_cbk, slot) :
+            glfs_pread_async(glfs_fd_p, slot->buf, len, offset, 0, aio_glfs_cbk, slot);
+          if (rc < OK) scallerr(is_write ? "glfs_pwrite_async" : "glfs_pread_async");
+        }
+}
+
+/* wait for one request to complete and return its slot to the free list */
+
+struct aio_slot * aio_reap( aio_ctx_t * ctx )
+{
+        int j;
+        ssize_t res;
+
+        if (prm.use_fuse) {
+          j = (int )uring_reap(&ctx->ring, &res);
+          ctx->slots[j].err = (res < 0) ? -res : 0;
+          ctx->slots[j].ret = (res < 0) ? -1 : res;
+        } else {
+          pthread_mutex_lock(&ctx->lock);
+          while (ctx->done_head == ctx->done_tail) pthread_cond_wait(&ctx->done_cv, &ctx->lock);
+          j = ctx->done_ring[ctx->done_head++ % ctx->qdepth];
+          pthread_mutex_unlock(&ctx->lock);
+        }
+        if (ctx->slots[j].ret < 0) errno = ctx->slots[j].err;
+        ctx->free_slots[ctx->nfree++] = j;
+        return &ctx->slots[j];
+}
+
+/* open-loop rate control: operation n is due at start + n * interval no matter how long earlier ones took.
+ * latency is measured from the due time, so a stall shows up as queueing delay for the operations
+ * behind it rather than silently lowering the offered load (coordinated omission) */
+
+struct pace {
+  uint64_t interval_ns;            /* 0 if this kind of operation is not paced */
+  uint64_t next_ns;                /* monotonic time the next operation is due */
+};
+typedef struct pace pace_t;
+
+void pace_init( pace_t * p, double rate, uint64_t start_ns, int thread_index, int threads )
+{
+  p->interval_ns = rate > 0.0 ? (uint64_t )(NSEC_PER_SEC / rate) : 0;
+  if (p->interval_ns == 0 && rate > 0.0) p->interval_ns = 1;
+  /* stagger threads across the first interval so they don't all issue at the same instant */
+  p->next_ns = start_ns + p->interval_ns * thread_index / threads;
+}
+
+/* wait until the next operation is due and return its due time, which callers use as the latency start */
+
+static inline uint64_t pace_wait( pace_t * p, gfapi_result_t * result_p )
+{
+  uint64_t due = p->next_ns, now = getmono_ns();
+  struct timespec ts;
+
+  p->next_ns += p->interval_ns;
+  result_p->paced_ops++;
+  if (now < due) {
+    result_p->pace_sleep_ns += due - now;
+    ts.tv_sec = due / 1000000000ULL;
+    ts.tv_nsec = due % 1000000000ULL;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) ;
+  } else {
+    if (now - due > result_p->max_lag_ns) result_p->max_lag_ns = now - due;
+    if (now - due > p->interval_ns) result_p->late_ops++;
+  }
+  return due;
+}
+
+/* difference between two getrusage() samples */
+
+void cpu_usage_delta( const struct rusage * start, const struct rusage * end, cpu_usage_t * out )
+{
+        out->user_sec = (end->ru_utime.tv_sec - start->ru_utime.tv_sec) + 
+                        (end->ru_utime.tv_usec - start->ru_utime.tv_usec) / 1000000.0;
+        out->sys_sec = (end->ru_stime.tv_sec - start->ru_stime.tv_sec) + 
+                       (end->ru_stime.tv_usec - start->ru_stime.tv_usec) / 1000000.0;
+        out->nvcsw = end->ru_nvcsw - start->ru_nvcsw;
+        out->nivcsw = end->ru_nivcsw - start->ru_nivcsw;
+        out->minflt = end->ru_minflt - start->ru_minflt;
+        out->majflt = end->ru_majflt - start->ru_majflt;
+}
+
+void cpu_usage_add( const cpu_usage_t * in, cpu_usage_t * out )
+{
+        out->user_sec += in->user_sec;
+        out->sys_sec += in->sys_sec;
+        out->nvcsw += in->nvcsw;
+        out->nivcsw += in->nivcsw;
+        out->minflt += in->minflt;
+        out->majflt += in->majflt;
+}
+
+/* stonewalling: the first thread to finish its work sets proc_shared->stonewall_ns, 
+ * every other thread then records what it had done so far, at its next I/O or file.
+ * throughput up to that point counts only the time when all threads were busy */
+
+void stonewall_snapshot( gfapi_result_t * result_p, uint64_t now_ns )
+{
+  live_stats_t * l = result_p->live;
+
+  result_p->sw_taken = 1;
+  result_p->sw_bytes = l->bytes;
+  result_p->sw_ios = l->ios;
+  result_p->sw_files = l->files_written + l->files_read + l->files_deleted + l->metadata_ops;
+  result_p->sw_elapsed = now_ns - result_p->start_time;
+  if (result_p->sw_elapsed == 0) result_p->sw_elapsed = 1;
+  result_p->sw_mbps = result_p->sw_bytes / (double )BYTES_PER_MB * NSEC_PER_SEC / result_p->sw_elapsed;
+  result_p->sw_iops = result_p->sw_ios * NSEC_PER_SEC / result_p->sw_elapsed;
+  result_p->sw_fps = result_p->sw_files * NSEC_PER_SEC / result_p->sw_elapsed;
+}
+
+/* called by a thread between I/Os and files, returns true if it should stop now */
+
+static inline int stonewall_check( gfapi_result_t * result_p )
+{
+  uint64_t sw_ns;
+
+  if (!prm.stonewall) return 0;
+  if (!result_p->sw_taken) {
+    sw_ns = __atomic_load_n(&proc_shared->stonewall_ns, __ATOMIC_RELAXED);
+    if (!sw_ns) return 0;
+    stonewall_snapshot(result_p, gettime_ns());
+  }
+  return prm.stonewall_stop;
+}
+
+/* called when a thread has done all its work, the first one fires the stonewall */
+
+void stonewall_finish( gfapi_result_t * result_p )
+{
+  uint64_t expected = 0;
+
+  if (!prm.stonewall) return;
+  __atomic_compare_exchange_n(&proc_shared->stonewall_ns, &expected, result_p->end_time, 0, 
+                              __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+  if (!result_p->sw_taken) stonewall_snapshot(result_p, result_p->end_time);
+}
+
+/* GFAPI_WARMUP: lookups, directory creation, empty caches and TCP windows still opening make the start of a run 
+ * slower than the rest of it.  when a thread's warm-up is over, it forgets what it has done so far and starts 
+ * measuring again, so everything reported, latencies and CPU usage included, comes from after the warm-up */
+
+static int threads_warming;        /* threads of this process that have not finished warming up */
+
+void warmup_end( gfapi_result_t * result_p )
+{
+  result_p->warming = 0;
+  result_p->total_bytes_xferred = result_p->total_io_count = result_p->io_calls = 0;
+  result_p->files_read = result_p->files_written = result_p->files_deleted = result_p->metadata_ops = 0;
+  result_p->paced_ops = result_p->late_ops = result_p->max_lag_ns = result_p->lag_sum_ns = result_p->replay_errors = 0;
+  result_p->pace_sleep_ns = result_p->dirs_created = 0;
+  memset(result_p->rec_class_ios, 0, sizeof(result_p->rec_class_ios));
+  memset(result_p->rec_class_bytes, 0, sizeof(result_p->rec_class_bytes));
+  memset(result_p->fsz_class_files, 0, sizeof(result_p->fsz_class_files));
+  memset(result_p->file_phase_ns, 0, sizeof(result_p->file_phase_ns));
+  memset(result_p->file_phase_count, 0, sizeof(result_p->file_phase_count));
+  memset(result_p->lat, 0, sizeof(result_p->lat));
+  result_p->start_time = gettime_ns();
+  result_p->warm_done_ns = getmono_ns();
+  getrusage(RUSAGE_THREAD, &result_p->ru_start);
+  if (prm.duration) result_p->deadline_ns = getmono_ns() + (uint64_t )prm.duration * 1000000000ULL;
+  /* process usage, libgfapi's event threads included, is measured once the last thread has warmed up */
+  if (__atomic_sub_fetch(&threads_warming, 1, __ATOMIC_ACQ_REL) == 0) getrusage(RUSAGE_SELF, &proc_ru_start);
+}
+
+/* called by a thread between I/Os and files, ends its warm-up when that is over and returns true if it should 
+ * stop now, because some process reached steady state or because of the stonewall */
+
+static inline int measure_check( gfapi_result_t * result_p )
+{
+  if (result_p->warming && 
+      (prm.warmup_ops ? result_p->total_io_count + result_p->metadata_ops + result_p->files_deleted >= prm.warmup_ops : 
+                        getmono_ns() >= result_p->warm_end_ns))
+    warmup_end(result_p);
+  if (prm.steady_cv > 0.0 && __atomic_load_n(&proc_shared->steady_ns, __ATOMIC_RELAXED)) return 1;
+  return stonewall_check(result_p);
+}
+
+/* written data content.  every block is copied out of one pool of random bytes, identical in all threads and 
+ * processes, so generating it is just memcpy and memset.  a duplicate block is one of the first DEDUPE_BLOCKS 
+ * blocks of the pool.  a unique block is a window at a random offset in the pool, stamped with the thread 
+ * and a counter so that no two are the same, even across clients.  the compressible part of each block is zeros at its end */
+
+static char * content_pool = NULL;
+
+struct content_gen {
+  uint64_t rnd_state;
+  uint64_t id;        /* host, process and thread */
+  uint64_t counter;
+};
+typedef struct content_gen content_gen_t;
+
+void content_pool_init( void )
+{
+        uint64_t state = 0x636f6e74656e74ULL, * p;  /* fixed seed, so content matches across runs and clients */
+        size_t j;
+
+        content_pool = memalign(1 << PAGE_BOUNDARY, CONTENT_POOL_SIZE + CONTENT_BLOCK);
+        if (!content_pool) scallerr("memalign content pool");
+        p = (uint64_t * )content_pool;
+        FOREACH(j, (CONTENT_POOL_SIZE + CONTENT_BLOCK) / sizeof(uint64_t)) p[j] = rnd_next(&state);
+}
+
+void fill_record( content_gen_t * g, char * buf, unsigned len )
+{
+        unsigned off, blk, n;
+        unsigned rand_len = CONTENT_BLOCK * (100 - prm.compress_pct) / 100;
+        uint64_t r;
+
+        for (off = 0; off < len; off += CONTENT_BLOCK) {
+          blk = (len - off < CONTENT_BLOCK) ? len - off : CONTENT_BLOCK;
+          n = (rand_len < blk) ? rand_len : blk;
+          r = rnd_next(&g->rnd_state);
+          if ((int )(r % 100) < prm.dedupe_pct) {
+            memcpy(buf + off, content_pool + ((r >> 8) % DEDUPE_BLOCKS) * CONTENT_BLOCK, n);
+          } else {
+            memcpy(buf + off, content_pool + ((r >> 8) % (CONTENT_POOL_SIZE / sizeof(uint64_t))) * sizeof(uint64_t), n);
+            if (n >= 2 * sizeof(uint64_t)) {
+              ((uint64_t * )(buf + off))[0] = g->id;
+              ((uint64_t * )(buf + off))[1] = ++g->counter;
+            }
+          }
+          memset(buf + off + n, 0, blk - n);
+        }
+}
+
+/* trace recording.  each thread appends to its own trace_buf, and they are merged when the test ends */
+
+static uint64_t trace_t0;          /* monotonic time that recorded timestamps are relative to */
+
+static inline uint32_t path_hash( const char * s )
+{
+        uint32_t h = 2166136261U;  /* FNV-1a */
+
+        while (*s) h = (h ^ (unsigned char )*s++) * 16777619U;
+        return h;
+}
+
+/* id of path, adding it to the table if it is new */
+
+uint32_t path_table_id( path_table_t * t, const char * path )
+{
+        uint32_t j, h, mask;
+
+        if (2 * (t->count + 1) > t->slot_count) {
+          uint32_t n = t->slot_count ? 2 * t->slot_count : 1024;
+          free(t->slots);
+          t->slots = (uint32_t * )calloc(n, sizeof(uint32_t));
+          if (!t->slots) scallerr("calloc path table");
+          t->slot_count = n;
+          FOREACH(j, t->count) {
+            for (h = path_hash(t->paths[j]) & (n - 1); t->slots[h]; h = (h + 1) & (n - 1)) ;
+            t->slots[h] = j + 1;
+          }
+        }
+        mask = t->slot_count - 1;
+        for (h = path_hash(path) & mask; t->slots[h]; h = (h + 1) & mask)
+          if (strcmp(t->paths[t->slots[h] - 1], path) == 0) return t->slots[h] - 1;
+        if (t->count == t->cap) {
+          t->cap = t->cap ? 2 * t->cap : 1024;
+          t->paths = (char ** )realloc(t->paths, t->cap * sizeof(char * ));
+          if (!t->paths) scallerr("realloc path table");
+        }
+        t->paths[t->count] = strdup(path);
+        if (!t->paths[t->count]) scallerr("strdup path");
+        t->slots[h] = t->count + 1;
+        return t->count++;
+}
+
+void trace_buf_free( trace_buf_t * tb )
+{
+        uint32_t j;
+
+        FOREACH(j, tb->paths.count) free(tb->paths.paths[j]);
+        free(tb->paths.paths);
+        free(tb->paths.slots);
+        free(tb->recs);
+        free(tb);
+}
+
+static inline void trace_buf_add( trace_buf_t * tb, int op, uint64_t offset, uint64_t length, uint64_t ts_ns )
+{
+        trace_rec_t * r;
+
+        if (tb->max && tb->count == tb->max) {
+          tb->dropped++;
+          return;
+        }
+        if (tb->count == tb->cap) {
+          tb->cap = tb->cap ? 2 * tb->cap : 65536;
+          if (tb->max && tb->cap > tb->max) tb->cap = tb->max;
+          tb->recs = (trace_rec_t * )realloc(tb->recs, tb->cap * sizeof(trace_rec_t));
+          if (!tb->recs) scallerr("realloc trace");
+        }
+        r = &tb->recs[tb->count++];
+        memset(r, 0, sizeof(*r));
+        r->ts_ns = ts_ns;
+        r->offset = offset;
+        r->length = (uint32_t )length;
+        r->path_id = tb->cur_path;
+        r->op = op;
+}
+
+/* record an operation on the current file that started at monotonic time start_ns */
+
+static inline void trace_add( gfapi_result_t * result_p, int op, uint64_t offset, uint64_t length, uint64_t start_ns )
+{
+        if (result_p->trace) trace_buf_add(result_p->trace, op, offset, length, start_ns > trace_t0 ? start_ns - trace_t0 : 0);
+}
+
+/* make path the current file for the operations recorded next, it is stored relative to GFAPI_BASEDIR */
+
+void trace_set_path( gfapi_result_t * result_p, const char * path )
+{
+        size_t n = strlen(prm.thrd_basedir);
+
+        if (!result_p->trace) return;
+        if (strncmp(path, prm.thrd_basedir, n) == 0 && path[n] == '/') path += n + 1;
+        result_p->trace->cur_path = path_table_id(&result_p->trace->paths, path);
+}
+
+/* size in bytes of the next I/O request, and its class in prm.rec_dist */
+
+static inline unsigned next_record_size( uint64_t * rnd_state_p, int * class_p )
+{
+        int c = prm.rec_dist.count > 1 ? size_dist_pick(&prm.rec_dist, rnd_double(rnd_state_p)) : 0;
+
+        *class_p = c;
+        return prm.rec_dist.kb[c] * BYTES_PER_KB;
+}
+
+/* bytes that sequential workloads transfer for one file, and its class in prm.fsz_dist.
+ * a file's size depends only on thread and file number, so a later read test knows what was written.
+ * with a single record size, files hold a whole number of records as they always have */
+
+uint64_t file_bytes( int thread_num, int filenum, int * class_p )
+{
+        uint64_t bytes, h;
+        int c = 0;
+
+        if (prm.fsz_dist.count > 1) {
+          h = ((uint64_t )thread_num << 32) | (uint32_t )filenum;
+          c = size_dist_pick(&prm.fsz_dist, rnd_double(&h));
+        }
+        *class_p = c;
+        bytes = prm.fsz_dist.kb[c] * BYTES_PER_KB;
+        if (prm.rec_dist.count == 1 && bytes >= prm.bytes_to_xfer) bytes -= bytes % prm.bytes_to_xfer;
+        return bytes;
+}
+
+static inline void count_request( gfapi_result_t * result_p, int size_class, ssize_t bytes )
+{
+        result_p->total_io_count++;
+        result_p->total_bytes_xferred += bytes;
+        result_p->rec_class_ios[size_class]++;
+        result_p->rec_class_bytes[size_class] += bytes;
+        live_add(&result_p->live->bytes, bytes);
+        live_add(&result_p->live->ios, 1);
+}
+
+/* in shared-file mode, the position of this thread among the threads sharing the file */
+
+static inline int shared_rank( gfapi_result_t * result_p )
+{
+        return prm.shared_all_procs ? result_p->thread_num : result_p->thread_num % prm.threads_per_proc;
+}
+
+/* offset of this thread's index'th record in the shared file.  strided interleaves threads record by record,
+ * blocked gives each thread a contiguous range, random visits all records in one pseudo-random order 
+ * (the same for all threads) and deals them out to threads like strided */
+
+static inline off_t shared_offset( offset_perm_t * perm, int rank, uint64_t index )
+{
+        switch (prm.shared_layout) {
+          case SHARED_STRIDED: return (off_t )(index * prm.sharers + rank) * prm.bytes_to_xfer;
+          case SHARED_BLOCKED: return (off_t )(rank * prm.io_requests + index) * prm.bytes_to_xfer;
+          default: return random_offset(perm, index * prm.sharers + rank);
+        }
+}
+
+/* path of the file shared by all threads, or by all threads of this process */
+
+void shared_file_path( char * path )
+{
+        if (prm.shared_all_procs) sprintf(path, "%s/%s.shared", prm.thrd_basedir, prm.prefix);
+        else sprintf(path, "%s/%s.shared.p%03d", prm.thrd_basedir, prm.prefix, prm.proc_num);
+}
+
+/* keep prm.qdepth requests in flight until all of this file's requests (or bytes, for sequential workloads) are done 
+ * (or the GFAPI_DURATION deadline passes), return the number of requests completed.  sequential workloads use explicit offsets
+ * starting from the current file position, so appends still go to end of file */
+
+unsigned async_io_loop( aio_ctx_t * ctx, gfapi_result_t * result_p, int workload, int fd, glfs_fd_t * glfs_fd_p, 
+                        offset_perm_t * perm, uint64_t * rnd_state_p, uint64_t file_size, content_gen_t * gen )
+{
+        unsigned next = 0, done = 0, len;
+        uint64_t submitted = 0;
+        int size_class;
+        int is_write = (workload == WL_SEQWR || workload == WL_RNDWR);
+        int is_random = (workload == WL_RNDWR || workload == WL_RNDRD);
+        lat_histo_t * h = &result_p->lat[is_write ? OP_WRITE : OP_READ];
+        off_t base = 0, offset;
+        struct aio_slot * slot;
+
+        if (!is_random && !prm.shared_layout) {
+          base = prm.use_fuse ? lseek(fd, 0, SEEK_CUR) : glfs_lseek(glfs_fd_p, 0, SEEK_CUR);
+          if (base < OK) scallerr(prm.use_fuse ? "lseek" : "glfs_lseek");
+        }
+        for (;;) {
+          while (ctx->nfree > 0 && (is_random ? next < prm.io_requests : submitted < file_size)) {
+            if (result_p->deadline_ns && getmono_ns() >= result_p->deadline_ns) break;
+            if (measure_check(result_p)) break;
+            len = next_record_size(rnd_state_p, &size_class);
+            if (prm.shared_layout) offset = shared_offset(perm, shared_rank(result_p), next);
+            else if (is_random) offset = next_random_offset(perm, next, rnd_state_p);
+            else {
+              offset = base + submitted;
+              if (len > file_size - submitted) len = file_size - submitted;
+            }
+            submitted += len;
+            if (is_write && prm.gen_content) fill_record(gen, aio_next_buf(ctx), len);
+            if (result_p->trace) trace_add(result_p, is_write ? TRACE_WRITE : TRACE_READ, offset, len, getmono_ns());
+            aio_submit(ctx, is_write, fd, glfs_fd_p, offset, len, size_class);
+            next++;
+          }
+          if (done == next) break; /* all done, or deadline passed and nothing left in flight */
+          slot = aio_reap(ctx);
+          if (slot->ret < (ssize_t )slot->len) {
+            const char * call = prm.use_fuse ? (is_write ? "io_uring write" : "io_uring read") : 
+                                               (is_write ? "glfs_pwrite_async" : "glfs_pread_async");
+            char short_msg[100];
+            if (slot->ret < 0) scallerr(call);
+            /* a short transfer is not an error to the kernel or libgfapi, so errno says nothing about it */
+            snprintf(short_msg, sizeof(short_msg), "%s moved %zd of %u bytes", call, slot->ret, slot->len);
+            errno = EIO;
+            scallerr(short_msg);
+          }
+          lat_record(h, slot->submit_ns);
+          count_request(result_p, slot->size_class, slot->ret);
+          done++;
+        }
+        return done;
+}
+
+/* GFAPI_SYNC_MODE fsync or fdatasync.  each file being written syncs after every prm.sync_every records, 
+ * or in the first write after prm.sync_every_ms have passed since its last sync, like a group commit */
+
+struct sync_state {
+  unsigned records;                /* written since the last sync */
+  uint64_t last_ns;                /* monotonic time of the last sync, or of the open */
+};
+typedef struct sync_state sync_state_t;
+
+/* count records just written and sync if it is time, return the time this finished */
+
+static inline uint64_t periodic_sync( gfapi_result_t * result_p, sync_state_t * ss, int fd, glfs_fd_t * glfs_fd_p, 
+                                      unsigned records, uint64_t now )
+{
+        int rc;
+
+        ss->records += records;
+        if (prm.sync_every_ms ? (now - ss->last_ns < prm.sync_every_ms * 1000000ULL) : (ss->records < prm.sync_every)) 
+          return now;
+        if (prm.sync_mode == SYNC_FDATASYNC) rc = prm.use_fuse ? fdatasync(fd) : glfs_fdatasync(glfs_fd_p);
+        else rc = prm.use_fuse ? fsync(fd) : glfs_fsync(glfs_fd_p);
+        if (rc < OK) scallerr(prm.use_fuse ? sync_mode_names[prm.sync_mode] : 
+                                             (prm.sync_mode == SYNC_FDATASYNC ? "glfs_fdatasync" : "glfs_fsync"));
+        trace_add(result_p, TRACE_FSYNC, 0, 0, now);
+        now = lat_record(&result_p->lat[OP_SYNC], now);
+        ss->records = 0;
+        ss->last_ns = now;
+        return now;
+}
+
+/* with GFAPI_IOV, each call moves up to prm.iov records, described by an iovec array over the thread's buffer 
+ * that is built once.  sequential workloads use writev/readv from the current file position, random workloads use 
+ * pwritev/preadv on a group of prm.iov consecutive records picked like a single random record.  latency and 
+ * GFAPI_TARGET_IOPS pacing are per call, the return value is the number of records done */
+
+unsigned vector_io_loop( gfapi_result_t * result_p, int workload, int fd, glfs_fd_t * glfs_fd_p, 
+                         struct iovec * iov, int * iov_class, offset_perm_t * perm, uint64_t * rnd_state_p, 
+                         uint64_t file_size, pace_t * pace, content_gen_t * gen, sync_state_t * ss )
+{
+        unsigned records = 0, calls = 0, len;
+        int n, j;
+        int is_write = (workload == WL_SEQWR || workload == WL_RNDWR);
+        int is_random = (workload == WL_RNDWR || workload == WL_RNDRD);
+        uint64_t done = 0, bytes, op_start = getmono_ns();
+        off_t offset = 0;
+        ssize_t ret;
+
+        while (is_random ? records < prm.io_requests : done < file_size) {
+          if (result_p->deadline_ns && op_start >= result_p->deadline_ns) break;
+          if (measure_check(result_p)) break;
+          bytes = 0;
+          for (n = 0; n < prm.iov && (is_random ? records + n < prm.io_requests : done + bytes < file_size); n++) {
+            len = next_record_size(rnd_state_p, &iov_class[n]);
+            if (!is_random && len > file_size - done - bytes) len = file_size - done - bytes;
+            if (is_write && prm.gen_content) fill_record(gen, iov[n].iov_base, len);
+            iov[n].iov_len = len;
+            bytes += len;
+          }
+          if (is_random) offset = next_random_offset(perm, calls, rnd_state_p) * prm.iov;
+          op_start = pace->interval_ns ? pace_wait(pace, result_p) : getmono_ns();
+          if (prm.use_fuse) 
+            ret = is_random ? (is_write ? pwritev(fd, iov, n, offset) : preadv(fd, iov, n, offset)) :
+                              (is_write ? writev(fd, iov, n) : readv(fd, iov, n));
+          else
+            ret = is_random ? (is_write ? glfs_pwritev(glfs_fd_p, iov, n, offset, 0) : glfs_preadv(glfs_fd_p, iov, n, offset, 0)) :
+                              (is_write ? glfs_writev(glfs_fd_p, iov, n, 0) : glfs_readv(glfs_fd_p, iov, n, 0));
+          if (ret < (ssize_t )bytes) 
+            scallerr(prm.use_fuse ? (is_random ? (is_write ? "pwritev" : "preadv") : (is_write ? "writev" : "readv")) :
+                                    (is_random ? (is_write ? "glfs_pwritev" : "glfs_preadv") : (is_write ? "glfs_writev" : "glfs_readv")));
+          if (result_p->trace) {
+            /* traces have no vectored operation, so each record is recorded as its own */
+            uint64_t pos = is_random ? (uint64_t )offset : done;
+            FOREACH(j, n) {
+              trace_add(result_p, is_write ? TRACE_WRITE : TRACE_READ, pos, iov[j].iov_len, op_start);
+              pos += iov[j].iov_len;
+            }
+          }
+          op_start = lat_record(&result_p->lat[is_write ? OP_WRITE : OP_READ], op_start);
+          if (is_write && (prm.sync_mode == SYNC_FSYNC || prm.sync_mode == SYNC_FDATASYNC)) 
+            op_start = periodic_sync(result_p, ss, fd, glfs_fd_p, n, op_start);
+          FOREACH(j, n) count_request(result_p, iov_class[j], iov[j].iov_len);
+          result_p->io_calls++;
+          records += n;
+          done += bytes;
+          calls++;
+        }
+        return records;
+}
+
+/* compute next pathname for thread to use 
+ * leaf directory number is filenum / files_per_dir, with GFAPI_DIR_DEPTH > 1 it is split into
+ * base GFAPI_DIRS_PER_DIR digits, one per level, and the top level takes whatever is left over.
+ * so depth 1 gives the original flat thrdNNN-dNNNN/ layout */
+
+void get_next_path( const int filenum, const int files_per_dir, const int thread_num, const char * base_dir, const char * prefix, char *next_fname  )
+{
+   int subdir = filenum / files_per_dir;
+   int level, len;
+   int digits[32];
+
+   FOREACH(level, prm.dir_depth - 1) {
+     digits[level] = subdir % prm.dirs_per_dir;
+     subdir /= prm.dirs_per_dir;
+   }
+   len = sprintf(next_fname, "%s/thrd%03d-d%04d", base_dir, thread_num, subdir);
+   for (level = prm.dir_depth - 2; level >= 0; level--) 
+     len += sprintf(next_fname + len, "/d%04d", digits[level]);
+   sprintf(next_fname + len, "/%s.%07d", prefix, filenum);
+}
+
+/* like "mkdir -p", returns number of directories created */
+
+int mkdir_p( glfs_t * fs, const char * dir )
+{
+  char parent[1024];
+  int rc, created = 0;
+
+  rc = prm.use_fuse ? mkdir(dir, 0755) : glfs_mkdir(fs, dir, 0755);
+  if (rc < OK && errno == ENOENT) {
+    strcpy(parent, dir);
+    created = mkdir_p(fs, dirname(parent));
+    rc = prm.use_fuse ? mkdir(dir, 0755) : glfs_mkdir(fs, dir, 0755);
+  }
+  if (rc < OK && errno != EEXIST) scallerr(dir);
+  return created + (rc == OK);
+}
+
+/* create parent directories of path, used when a create finds that they are not there yet */
+
+int make_parent_dir( glfs_t * fs, const char * path )
+{
+  char subdir[1024];
+
+  strcpy(subdir, path);
+  return mkdir_p(fs, dirname(subdir));
+}
+
+/* make every leaf directory that files 0..filecount-1 will go in, so the timed phase 
+ * measures only file creation.  all threads do this at once, each for its own tree */
+
+uint64_t precreate_dirs( gfapi_result_t * result_p )
+{
+  char path[1024];
+  int filenum;
+  uint64_t created = 0;
+
+  for (filenum = 0; filenum < prm.filecount; filenum += prm.files_per_dir) {
+    get_next_path( filenum, prm.files_per_dir, result_p->thread_num, prm.thrd_basedir, prm.prefix, path );
+    created += make_parent_dir(result_p->fs, path);
+  }
+  return created;
+}
+
+/* list the directory containing path like "ls -l", readdirp followed by a stat of every entry 
+ * readdir latency is recorded once per directory and excludes the time spent in stat calls */
+
+uint64_t list_dir_and_stat( gfapi_result_t * result_p, const char * path )
+{
+  glfs_t * fs = result_p->fs;
+  char dir[1024], entpath[1024+NAME_MAX+2];
+  struct stat st;
+  struct dirent de, * de_p;
+  DIR * dir_p = NULL;
+  glfs_fd_t * glfs_dir_p = NULL;
+  uint64_t entries = 0, readdir_ns = 0, t0;
+  int rc;
+
+  strcpy(dir, path);
+  dirname(dir);
+  t0 = getmono_ns();
+  if (prm.use_fuse) dir_p = opendir(dir);
+  else glfs_dir_p = glfs_opendir(fs, dir);
+  if (!dir_p && !glfs_dir_p) scallerr(dir);
+  for (;;) {
+    if (prm.use_fuse) {
+      errno = 0;
+      de_p = readdir(dir_p);
+      if (!de_p && errno) scallerr("readdir");
+    } else {
+      rc = glfs_readdirplus_r(glfs_dir_p, &st, &de, &de_p);
+      if (rc) scallerr("glfs_readdirplus_r");
+    }
+    readdir_ns += getmono_ns() - t0;
+    if (!de_p) break;
+    if (strcmp(de_p->d_name, ".") && strcmp(de_p->d_name, "..")) {
+      sprintf(entpath, "%s/%s", dir, de_p->d_name);
+      t0 = getmono_ns();
+      rc = prm.use_fuse ? lstat(entpath, &st) : glfs_lstat(fs, entpath, &st);
+      if (rc < OK) scallerr(entpath);
+      lat_record(&result_p->lat[OP_STAT], t0);
+      entries++;
+    }
+    t0 = getmono_ns();
+  }
+  /* readdir_ns already holds the final empty readdir, only the closedir is added to it */
+  t0 = getmono_ns();
+  rc = prm.use_fuse ? closedir(dir_p) : glfs_closedir(glfs_dir_p);
+  if (rc < OK) scallerr(prm.use_fuse ? "closedir" : "glfs_closedir");
+  lat_record_ns(&result_p->lat[OP_READDIR], readdir_ns + getmono_ns() - t0);
+  return entries + 1;
+}
+
+/* run one metadata-only operation on path through POSIX or libgfapi, 
+ * returns number of metadata operations done */
+
+uint64_t metadata_op( gfapi_result_t * result_p, int workload, const char * path, int filenum, uint64_t op_start )
+{
+  glfs_t * fs = result_p->fs;
+  char other_path[1024+10], xattr_buf[XATTR_VALUE_SIZE];
+  struct stat st;
+  int rc = OK, fd;
+  glfs_fd_t * glfs_fd_p;
+  ssize_t sz;
+  mode_t mode = (filenum & 1) ? 0640 : 0644;
+
+  switch (workload) {
+    case WL_STAT:
+      rc = prm.use_fuse ? stat(path, &st) : glfs_stat(fs, path, &st);
+      if (rc < OK) scallerr(path);
+      trace_add(result_p, TRACE_STAT, 0, 0, op_start);
+      lat_record(&result_p->lat[OP_STAT], op_start);
+      break;
+
+    case WL_CHMOD:
+      rc = prm.use_fuse ? chmod(path, mode) : glfs_chmod(fs, path, mode);
+      if (rc < OK) scallerr(path);
+      lat_record(&result_p->lat[OP_CHMOD], op_start);
+      break;
+
+    case WL_SETXATTR:
+      memset(xattr_buf, 'x', sizeof(xattr_buf));
+      sprintf(xattr_buf, "%d", filenum);
+      rc = prm.use_fuse ? 
+        setxattr(path, XATTR_NAME, xattr_buf, sizeof(xattr_buf), 0) :
+        glfs_setxattr(fs, path, XATTR_NAME, xattr_buf, sizeof(xattr_buf), 0);
+      if (rc < OK) scallerr(path);
+      lat_record(&result_p->lat[OP_SETXATTR], op_start);
+      break;
+
+    case WL_GETXATTR:
+      /* a missing xattr still costs a full lookup, so ENODATA is not an error */
+      sz = prm.use_fuse ? 
+        getxattr(path, XATTR_NAME, xattr_buf, sizeof(xattr_buf)) :
+        glfs_getxattr(fs, path, XATTR_NAME, xattr_buf, sizeof(xattr_buf));
+      if (sz < 0 && errno != ENODATA) scallerr(path);
+      lat_record(&result_p->lat[OP_GETXATTR], op_start);
+      break;
+
+    case WL_RENAME:
+      /* each rename run flips files between their original name and name.rnm */
+      sprintf(other_path, "%s.rnm", path);
+      rc = prm.use_fuse ? rename(path, other_path) : glfs_rename(fs, path, other_path);
+      if (rc < OK && errno == ENOENT) 
+        rc = prm.use_fuse ? rename(other_path, path) : glfs_rename(fs, other_path, path);
+      if (rc < OK) scallerr(path);
+      lat_record(&result_p->lat[OP_RENAME], op_start);
+      break;
+
+    case WL_CREATE:
+      if (prm.use_fuse) {
+        fd = open(path, O_WRONLY|O_CREAT|O_EXCL, 0666);
+        if (fd < OK && errno == ENOENT) {
+          make_parent_dir(fs, path);
+          fd = open(path, O_WRONLY|O_CREAT|O_EXCL, 0666);
+        }
+        if (fd < OK) scallerr(path);
+        rc = close(fd);
+      } else {
+        glfs_fd_p = glfs_creat(fs, path, O_WRONLY|O_CREAT|O_EXCL, 0666);
+        if (!glfs_fd_p && errno == ENOENT) {
+          make_parent_dir(fs, path);
+          glfs_fd_p = glfs_creat(fs, path, O_WRONLY|O_CREAT|O_EXCL, 0666);
+        }
+        if (!glfs_fd_p) scallerr(path);
+        rc = glfs_close(glfs_fd_p);
+      }
+      if (rc < OK) scallerr(prm.use_fuse ? "close" : "glfs_close");
+      trace_add(result_p, TRACE_CREATE, 0, 0, op_start);
+      trace_add(result_p, TRACE_CLOSE, 0, 0, op_start);
+      lat_record(&result_p->lat[OP_CREATE], op_start);
+      break;
+
+    case WL_MKDIR:
+      rc = prm.use_fuse ? mkdir(path, 0755) : glfs_mkdir(fs, path, 0755);
+      if (rc < OK && errno == ENOENT) {
+        make_parent_dir(fs, path);
+        rc = prm.use_fuse ? mkdir(path, 0755) : glfs_mkdir(fs, path, 0755);
+      }
+      if (rc < OK) scallerr(path);
+      trace_add(result_p, TRACE_MKDIR, 0, 0, op_start);
+      lat_record(&result_p->lat[OP_MKDIR], op_start);
+      break;
+
+    case WL_LSL:
+      /* list each leaf directory once, when we reach its first file */
+      if (filenum % prm.files_per_dir) return 0;
+      return list_dir_and_stat(result_p, path);
+
+    default: exit(NOTOK);
+  }
+  return 1;
+}
+
+/* write the traces in bufs, each already in time order, to one trace file.  ties go to the lower-numbered 
+ * buffer, so that operations a thread recorded at the same time keep their order */
+
+void trace_save( const char * path, trace_buf_t ** bufs, int nbufs )
+{
+        FILE * f = fopen(path, "w");
+        path_table_t paths = {0};
+        struct trace_header hdr = {0};
+        uint64_t * next = (uint64_t * )calloc(nbufs, sizeof(uint64_t));
+        uint32_t ** path_map = (uint32_t ** )calloc(nbufs, sizeof(uint32_t * ));
+        trace_rec_t r;
+        uint64_t dropped = 0;
+        uint32_t j;
+        int b, best;
+
+        if (!f) scallerr(path);
+        if (!next || !path_map) scallerr("calloc trace merge");
+        FOREACH(b, nbufs) {
+          path_map[b] = (uint32_t * )malloc((bufs[b]->paths.count + 1) * sizeof(uint32_t));
+          if (!path_map[b]) scallerr("malloc trace merge");
+          FOREACH(j, bufs[b]->paths.count) path_map[b][j] = path_table_id(&paths, bufs[b]->paths.paths[j]);
+          hdr.rec_count += bufs[b]->count;
+          dropped += bufs[b]->dropped;
+        }
+        if (fwrite(&hdr, sizeof(hdr), 1, f) != 1) scallerr(path);
+        for (;;) {
+          best = -1;
+          FOREACH(b, nbufs) 
+            if (next[b] < bufs[b]->count && 
+                (best < 0 || bufs[b]->recs[next[b]].ts_ns < bufs[best]->recs[next[best]].ts_ns)) best = b;
+          if (best < 0) break;
+          r = bufs[best]->recs[next[best]++];
+          r.path_id = path_map[best][r.path_id];
+          hdr.duration_ns = r.ts_ns;
+          if (fwrite(&r, sizeof(r), 1, f) != 1) scallerr(path);
+        }
+        FOREACH(j, paths.count) 
+          if (fwrite(paths.paths[j], strlen(paths.paths[j]) + 1, 1, f) != 1) scallerr(path);
+        hdr.magic = TRACE_MAGIC;
+        hdr.version = TRACE_VERSION;
+        hdr.rec_size = sizeof(trace_rec_t);
+        hdr.path_count = paths.count;
+        rewind(f);
+        if (fwrite(&hdr, sizeof(hdr), 1, f) != 1) scallerr(path);
+        if (fclose(f)) scallerr(path);
+        printf("%s : trace of "UINT64DFMT" operations on %u paths written to %s\n", now_str(), hdr.rec_count, hdr.path_count, path);
+        if (dropped) 
+          printf("  WARNING: "UINT64DFMT" more operations were not recorded, threads that filled their share of GFAPI_TRACE_MAX_OPS stopped recording\n", 
+                 dropped);
+        FOREACH(b, nbufs) free(path_map[b]);
+        FOREACH(j, paths.count) free(paths.paths[j]);
+        free(paths.paths);
+        free(paths.slots);
+        free(path_map);
+        free(next);
+}
+
+/* where a worker process writes the trace it records.  each phase of a job file, and each worker process, 
+ * gets its own file so that none overwrites another's.  proc_num -1 names them all, for printing */
+
+void trace_record_path( char * buf, size_t len, int proc_num )
+{
+        char proc[16] = "";
+
+        if (prm.processes > 1) {
+          if (proc_num < 0) strcpy(proc, ".pNNN");
+          else snprintf(proc, sizeof(proc), ".p%03d", proc_num);
+        }
+        snprintf(buf, len, "%s%s%s%s", prm.trace_file, phase_count > 1 ? "." : "", phase_count > 1 ? prm.phase_name : "", proc);
+}
+
+/* trace importer.  strace paths have a prefix (usually the mountpoint) removed, and if one is given, 
+ * paths outside it are dropped.  what is left is relative to GFAPI_BASEDIR when replayed */
+
+static int import_path( trace_buf_t * tb, const char * path, const char * strip )
+{
+        size_t n = strlen(strip);
+
+        if (n > 0) {
+          if (strncmp(path, strip, n) != 0) return 0;
+          path += n;
+        }
+        while (*path == '/') path++;
+        if (!*path) return 0;
+        if (strlen(path) >= TRACE_MAX_PATH) usage2("trace path %.100s... is too long to replay", path);
+        tb->cur_path = path_table_id(&tb->paths, path);
+        return 1;
+}
+
+/* first quoted string in s, with strace escapes undone */
+
+static int quoted_arg( const char * s, char * out, size_t outlen )
+{
+        const char * p = strchr(s, '"');
+        size_t n = 0;
+        int c, k;
+
+        if (!p) return 0;
+        for (p++; *p && *p != '"'; p++) {
+          c = *p;
+          if (c == '\\' && p[1]) {
+            c = *++p;
+            if (c >= '0' && c <= '7') {
+              for (c = 0, k = 0; k < 3 && *p >= '0' && *p <= '7'; k++, p++) c = c * 8 + (*p - '0');
+              p--;
+            } else if (c == 'n') c = '\n';
+            else if (c == 't') c = '\t';
+          }
+          if (n + 1 < outlen) out[n++] = c;
+        }
+        out[n] = 0;
+        return *p == '"';
+}
+
+#define IMPORT_MAX_FD 65536
+#define IMPORT_MAX_PENDING 256
+
+/* convert a text trace to a binary one.  a line is either "seconds op path [offset length]", with op one of 
+ * trace_op_names, or a line of "strace -f -ttt" (or -tt) output.  from strace, only operations on files opened 
+ * within the trace are kept, all processes are treated as sharing one table of fds, failed calls are skipped, 
+ * and calls interrupted by another thread's are joined up and kept in the order they completed */
+
+void trace_import( const char * in_path, const char * out_path, const char * strip )
+{
+        FILE * f = fopen(in_path, "r");
+        trace_buf_t * tb = (trace_buf_t * )calloc(1, sizeof(trace_buf_t));
+        uint32_t * fd_path = (uint32_t * )calloc(IMPORT_MAX_FD, sizeof(uint32_t));  /* path_id + 1, 0 if not tracked */
+        uint64_t * fd_pos = (uint64_t * )calloc(IMPORT_MAX_FD, sizeof(uint64_t));
+        struct { int pid; double ts; char * text; } pending[IMPORT_MAX_PENDING];
+        char * line = NULL, * joined = NULL, * p, * q, * name, * args, * eq;
+        char opname[32], path[4096];
+        size_t line_cap = 0;
+        uint64_t lines = 0, ts_ns, last_ns = 0, off, len;
+        double ts, t_first = -1.0;
+        long long ret;
+        int pid, fd, op, n, h, m, j;
+
+        if (!f) scallerr(in_path);
+        if (!tb || !fd_path || !fd_pos) scallerr("calloc trace import");
+        memset(pending, 0, sizeof(pending));
+        while (getline(&line, &line_cap, f) > 0) {
+          lines++;
+          free(joined);
+          joined = NULL;
+          for (q = line + strlen(line); q > line && isspace(q[-1]); q--) ;
+          *q = 0;
+          for (p = line; isspace(*p); p++) ;
+
+          /* text form */
+          n = 0;
+          if (sscanf(p, "%lf %31s %4095s %n", &ts, opname, path, &n) == 3) {
+            FOREACH(op, TRACE_OPS) if (strcmp(opname, trace_op_names[op]) == 0) break;
+            if (op < TRACE_OPS) {
+              off = len = 0;
+              sscanf(p + n, "%lu %lu", &off, &len);
+              /* text paths are usually relative already, only strip the prefix if they have it */
+              if (!import_path(tb, path, strncmp(path, strip, strlen(strip)) ? "" : strip)) continue;
+              pid = 0;
+              goto add;
+            }
+          }
+
+          /* strace: optional pid, then the time */
+          pid = 0;
+          if (strncmp(p, "[pid", 4) == 0) {
+            pid = atoi(p + 4);
+            if (!(p = strchr(p, ']'))) continue;
+            p++;
+          } else {
+            for (q = p; isdigit(*q); q++) ;
+            if (q > p && *q == ' ') {
+              pid = atoi(p);
+              p = q;
+            }
+          }
+          while (isspace(*p)) p++;
+          if (sscanf(p, "%d:%d:%lf", &h, &m, &ts) == 3 && strchr(p, ':') < strchr(p, ' ')) ts += h * 3600 + m * 60;
+          else if (sscanf(p, "%lf", &ts) != 1) continue;
+          while (*p && !isspace(*p)) p++;
+          while (isspace(*p)) p++;
+          if (*p == '+' || *p == '-') continue;  /* exit or signal */
+
+          if ((q = strstr(p, " <unfinished ...>"))) {
+            *q = 0;
+            FOREACH(j, IMPORT_MAX_PENDING) if (!pending[j].text) break;
+            if (j == IMPORT_MAX_PENDING) continue;
+            pending[j].pid = pid;
+            pending[j].ts = ts;
+            pending[j].text = strdup(p);
+            if (!pending[j].text) scallerr("strdup trace import");
+            continue;
+          }
+          if (strncmp(p, "<... ", 5) == 0) {
+            if (!(q = strstr(p, " resumed>"))) continue;
+            FOREACH(j, IMPORT_MAX_PENDING) if (pending[j].text && pending[j].pid == pid) break;
+            if (j == IMPORT_MAX_PENDING) continue;
+            joined = (char * )malloc(strlen(pending[j].text) + strlen(q) + 1);
+            if (!joined) scallerr("malloc trace import");
+            sprintf(joined, "%s%s", pending[j].text, q + strlen(" resumed>"));
+            free(pending[j].text);
+            pending[j].text = NULL;
+            ts = pending[j].ts;
+            p = joined;
+          }
+
+          /* name(args) = ret */
+          name = p;
+          if (!(args = strchr(p, '('))) continue;
+          *args++ = 0;
+          if (!(eq = strstr(args, ") = "))) continue;
+          while ((q = strstr(eq + 1, ") = "))) eq = q;
+          *eq = 0;
+          if (sscanf(eq + 4, "%lld", &ret) != 1 || ret < 0) continue;
+          off = len = 0;
+          fd = atoi(args);
+          if (!strcmp(name, "open") || !strcmp(name, "openat") || !strcmp(name, "creat")) {
+            if (ret >= IMPORT_MAX_FD || strstr(args, "O_DIRECTORY") || !quoted_arg(args, path, sizeof(path))) continue;
+            if (!import_path(tb, path, strip)) continue;
+            op = (!strcmp(name, "creat") || strstr(args, "O_TRUNC")) ? TRACE_CREATE :
+                 (strstr(args, "O_WRONLY") || strstr(args, "O_RDWR")) ? TRACE_OPEN_WR : TRACE_OPEN_RD;
+            fd_path[ret] = tb->cur_path + 1;
+            fd_pos[ret] = 0;
+          } else if (!strcmp(name, "read") || !strcmp(name, "write") || !strcmp(name, "readv") || !strcmp(name, "writev") ||
+                     !strcmp(name, "pread64") || !strcmp(name, "pwrite64") || !strcmp(name, "preadv") || !strcmp(name, "pwritev")) {
+            if (fd < 0 || fd >= IMPORT_MAX_FD || !fd_path[fd] || ret == 0) continue;
+            tb->cur_path = fd_path[fd] - 1;
+            op = strstr(name, "write") ? TRACE_WRITE : TRACE_READ;
+            len = ret;
+            if (name[0] == 'p') {
+              if (!(q = strrchr(args, ','))) continue;
+              off = strtoull(q + 1, NULL, 0);
+            } else {
+              off = fd_pos[fd];
+              fd_pos[fd] += ret;
+            }
+          } else if (!strcmp(name, "lseek")) {
+            if (fd >= 0 && fd < IMPORT_MAX_FD) fd_pos[fd] = ret;
+            continue;
+          } else if (!strcmp(name, "dup") || !strcmp(name, "dup2") || !strcmp(name, "dup3")) {
+            if (fd < 0 || fd >= IMPORT_MAX_FD || ret >= IMPORT_MAX_FD) continue;
+            fd_path[ret] = fd_path[fd];
+            fd_pos[ret] = fd_pos[fd];
+            continue;
+          } else if (!strcmp(name, "fsync") || !strcmp(name, "fdatasync") || !strcmp(name, "close")) {
+            if (fd < 0 || fd >= IMPORT_MAX_FD || !fd_path[fd]) continue;
+            tb->cur_path = fd_path[fd] - 1;
+            op = (name[0] == 'c') ? TRACE_CLOSE : TRACE_FSYNC;
+            if (op == TRACE_CLOSE) fd_path[fd] = 0;
+          } else if (!strcmp(name, "unlink") || !strcmp(name, "unlinkat") || !strcmp(name, "rmdir")) {
+            if (!quoted_arg(args, path, sizeof(path)) || !import_path(tb, path, strip)) continue;
+            op = TRACE_UNLINK;
+          } else if (!strcmp(name, "stat") || !strcmp(name, "lstat") || !strcmp(name, "newfstatat") || 
+                     !strcmp(name, "statx") || !strcmp(name, "stat64") || !strcmp(name, "lstat64")) {
+            if (!quoted_arg(args, path, sizeof(path)) || !import_path(tb, path, strip)) continue;
+            op = TRACE_STAT;
+          } else if (!strcmp(name, "mkdir") || !strcmp(name, "mkdirat")) {
+            if (!quoted_arg(args, path, sizeof(path)) || !import_path(tb, path, strip)) continue;
+            op = TRACE_MKDIR;
+          } else {
+            continue;
+          }
+add:
+          if (t_first < 0.0) t_first = ts;
+          ts_ns = (uint64_t )((ts - t_first) * NSEC_PER_SEC);
+          if (ts_ns < last_ns || ts < t_first) ts_ns = last_ns;  /* completion order, or a line out of order */
+          last_ns = ts_ns;
+          trace_buf_add(tb, op, off, len, ts_ns);
+        }
+        fclose(f);
+        printf("imported "UINT64DFMT" operations on %u paths from "UINT64DFMT" lines of %s\n", 
+               tb->count, tb->paths.count, lines, in_path);
+        trace_save(out_path, &tb, 1);
+        FOREACH(j, IMPORT_MAX_PENDING) free(pending[j].text);
+        free(joined);
+        free(line);
+        free(fd_path);
+        free(fd_pos);
+        trace_buf_free(tb);
+}
+
+/* map a trace for the replay workload and check that it is one */
+
+struct replay_trace * trace_map( const char * path )
+{
+        struct replay_trace * rt = (struct replay_trace * )calloc(1, sizeof(struct replay_trace));
+        struct stat st;
+        char * base, * p, * end, * nul;
+        uint64_t j, path_bytes;
+        int fd;
+
+        if (!rt) scallerr("calloc replay");
+        fd = open(path, O_RDONLY);
+        if (fd < OK || fstat(fd, &st) < OK) scallerr(path);
+        if (st.st_size < sizeof(struct trace_header)) usage2("%s is not a gfapi_perf_test trace", path);
+        base = (char * )mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (base == MAP_FAILED) scallerr("mmap trace");
+        close(fd);
+        rt->hdr = (struct trace_header * )base;
+        if (rt->hdr->magic != TRACE_MAGIC || rt->hdr->version != TRACE_VERSION || rt->hdr->rec_size != sizeof(trace_rec_t) ||
+            rt->hdr->rec_count > (st.st_size - sizeof(struct trace_header)) / sizeof(trace_rec_t))
+          usage2("%s is not a gfapi_perf_test trace", path);
+        rt->recs = (trace_rec_t * )(base + sizeof(struct trace_header));
+        /* each path takes at least its NUL, so a path count larger than the rest of the file is bad, 
+         * and is caught before it sizes anything */
+        path_bytes = st.st_size - sizeof(struct trace_header) - rt->hdr->rec_count * sizeof(trace_rec_t);
+        if (rt->hdr->path_count > path_bytes) usage2("trace %s has a truncated path table", path);
+        rt->paths = (char ** )calloc((size_t )rt->hdr->path_count + 1, sizeof(char * ));
+        if (!rt->paths) scallerr("calloc trace paths");
+        p = (char * )(rt->recs + rt->hdr->rec_count);
+        end = base + st.st_size;
+        FOREACH(j, rt->hdr->path_count) {
+          if (p >= end || !(nul = (char * )memchr(p, 0, end - p))) usage2("trace %s has a truncated path table", path);
+          if (nul - p >= TRACE_MAX_PATH || strlen(prm.thrd_basedir) + 1 + (nul - p) >= PATH_MAX) 
+            usage2("trace %s has a path too long to replay below GFAPI_BASEDIR", path);
+          rt->paths[j] = p;
+          p = nul + 1;
+        }
+        FOREACH(j, rt->hdr->rec_count) {
+          trace_rec_t * r = &rt->recs[j];
+          if (r->path_id >= rt->hdr->path_count || r->op >= TRACE_OPS || r->length > TRACE_MAX_LEN) 
+            usage2("trace %s has a bad record", path);
+          if ((r->op == TRACE_READ || r->op == TRACE_WRITE) && r->length > rt->max_len) rt->max_len = r->length;
+        }
+        printf("  replaying "UINT64DFMT" operations on %u paths from %.2f sec of trace time\n", 
+               rt->hdr->rec_count, rt->hdr->path_count, rt->hdr->duration_ns / NSEC_PER_SEC);
+        return rt;
+}
+
+/* where a trace path is replayed, in a PATH_MAX buffer.  trace_map refused paths too long for that */
+
+static void replay_path( char * buf, const char * rel )
+{
+        if (snprintf(buf, PATH_MAX, "%s/%s", prm.thrd_basedir, rel) >= PATH_MAX) {
+          errno = ENAMETOOLONG;
+          scallerr(rel);
+        }
+}
+
+/* deal out trace records to this process's threads by path, so each file's operations stay in order on one thread */
+
+void replay_shard( gfapi_result_t * result_array )
+{
+        struct replay_trace * rt = prm.replay;
+        int threads = prm.threads_per_proc * prm.processes;
+        uint64_t j;
+        int t, g;
+
+        free(rt->files);
+        rt->files = (struct replay_file * )calloc((size_t )rt->hdr->path_count + 1, sizeof(struct replay_file));
+        if (!rt->files) scallerr("calloc replay files");
+        FOREACH(j, rt->hdr->path_count) rt->files[j].fd = -1;
+        FOREACH(j, rt->hdr->rec_count) {
+          g = rt->recs[j].path_id % threads;
+          if (g / prm.threads_per_proc == prm.proc_num) result_array[g % prm.threads_per_proc].replay_count++;
+        }
+        FOREACH(t, prm.threads_per_proc) {
+          result_array[t].replay_idx = (uint64_t * )malloc((result_array[t].replay_count + 1) * sizeof(uint64_t));
+          if (!result_array[t].replay_idx) scallerr("malloc replay");
+          result_array[t].replay_count = 0;
+        }
+        FOREACH(j, rt->hdr->rec_count) {
+          g = rt->recs[j].path_id % threads;
+          if (g / prm.threads_per_proc == prm.proc_num) {
+            gfapi_result_t * result_p = &result_array[g % prm.threads_per_proc];
+            result_p->replay_idx[result_p->replay_count++] = j;
+          }
+        }
+}
+
+static int replay_open( gfapi_result_t * result_p, struct replay_file * f, const char * path, int flags )
+{
+        glfs_t * fs = result_p->fs;
+
+        flags |= prm.o_direct;
+        if (prm.use_fuse) {
+          f->fd = open(path, flags, 0666);
+          if (f->fd < OK && errno == ENOENT && (flags & O_CREAT)) {
+            make_parent_dir(fs, path);
+            f->fd = open(path, flags, 0666);
+          }
+          return f->fd >= OK;
+        }
+        f->glfs_fd_p = (flags & O_CREAT) ? glfs_creat(fs, path, flags, 0666) : glfs_open(fs, path, flags);
+        if (!f->glfs_fd_p && errno == ENOENT && (flags & O_CREAT)) {
+          make_parent_dir(fs, path);
+          f->glfs_fd_p = glfs_creat(fs, path, flags, 0666);
+        }
+        return f->glfs_fd_p != NULL;
+}
+
+static int replay_close( gfapi_result_t * result_p, struct replay_file * f )
+{
+        int rc = prm.use_fuse ? close(f->fd) : glfs_close(f->glfs_fd_p);
+
+        f->fd = -1;
+        f->glfs_fd_p = NULL;
+        f->opens = 0;
+        if (f->did_write) {
+          result_p->files_written++;
+          live_add(&result_p->live->files_written, 1);
+        } else if (f->did_read) {
+          result_p->files_read++;
+          live_add(&result_p->live->files_read, 1);
+        }
+        f->did_read = f->did_write = 0;
+        return rc;
+}
+
+/* replay this thread's share of the trace.  with GFAPI_REPLAY_SPEED, each operation waits until its trace time 
+ * (divided by the speed) and its latency counts from then, like open-loop pacing.  failed operations are counted 
+ * rather than fatal, since a trace captured elsewhere may not match the files that are here */
+
+void replay_run( gfapi_result_t * result_p, char * buf, content_gen_t * gen )
+{
+        struct replay_trace * rt = prm.replay;
+        glfs_t * fs = result_p->fs;
+        uint64_t j, start = getmono_ns(), due, now, op_start;
+        trace_rec_t * r;
+        struct replay_file * f;
+        struct timespec ts;
+        struct stat st;
+        char path[PATH_MAX];
+        ssize_t n;
+        int rc, flags;
+
+        FOREACH(j, result_p->replay_count) {
+          if (result_p->deadline_ns && getmono_ns() >= result_p->deadline_ns) break;
+          if (measure_check(result_p)) break;
+          r = &rt->recs[result_p->replay_idx[j]];
+          f = &rt->files[r->path_id];
+          if (prm.replay_speed > 0.0) {
+            due = start + (uint64_t )(r->ts_ns / prm.replay_speed);
+            now = getmono_ns();
+            result_p->paced_ops++;
+            if (now < due) {
+              ts.tv_sec = due / 1000000000ULL;
+              ts.tv_nsec = due % 1000000000ULL;
+              while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) ;
+            } else {
+              result_p->lag_sum_ns += now - due;
+              if (now - due > result_p->max_lag_ns) result_p->max_lag_ns = now - due;
+              if (now - due > REPLAY_LATE_NS) result_p->late_ops++;
+            }
+            op_start = due;
+          } else {
+            op_start = getmono_ns();
+          }
+          switch (r->op) {
+            case TRACE_OPEN_RD:
+            case TRACE_OPEN_WR:
+            case TRACE_CREATE:
+              if (f->opens++ > 0) break;  /* the trace had it open more than once, keep one open */
+              flags = (r->op == TRACE_OPEN_RD) ? O_RDONLY : (r->op == TRACE_OPEN_WR) ? O_RDWR|O_CREAT : O_RDWR|O_CREAT|O_TRUNC;
+              replay_path(path, rt->paths[r->path_id]);
+              if (!replay_open(result_p, f, path, flags)) {
+                f->opens = 0;
+                result_p->replay_errors++;
+                break;
+              }
+              lat_record(&result_p->lat[OP_OPEN], op_start);
+              break;
+
+            case TRACE_READ:
+            case TRACE_WRITE:
+              if (f->opens == 0) {
+                /* the file was already open when the trace started */
+                replay_path(path, rt->paths[r->path_id]);
+                if (!replay_open(result_p, f, path, O_RDWR|O_CREAT)) {
+                  result_p->replay_errors++;
+                  break;
+                }
+                f->opens = 1;
+              }
+              if (r->op == TRACE_WRITE) {
+                if (prm.gen_content) fill_record(gen, buf, r->length);
+                n = prm.use_fuse ? pwrite(f->fd, buf, r->length, r->offset) : glfs_pwrite(f->glfs_fd_p, buf, r->length, r->offset, 0);
+                f->did_write = 1;
+              } else {
+                n = prm.use_fuse ? pread(f->fd, buf, r->length, r->offset) : glfs_pread(f->glfs_fd_p, buf, r->length, r->offset, 0);
+                f->did_read = 1;
+              }
+              if (n < 0) {
+                result_p->replay_errors++;
+                break;
+              }
+              lat_record(&result_p->lat[r->op == TRACE_WRITE ? OP_WRITE : OP_READ], op_start);
+              count_request(result_p, 0, n);
+              break;
+
+            case TRACE_FSYNC:
+              if (f->opens == 0) break;
+              rc = prm.use_fuse ? fsync(f->fd) : glfs_fsync(f->glfs_fd_p);
+              if (rc < OK) result_p->replay_errors++;
+              else lat_record(&result_p->lat[OP_FSYNC], op_start);
+              break;
+
+            case TRACE_CLOSE:
+              if (f->opens == 0 || --f->opens > 0) break;
+              if (replay_close(result_p, f) < OK) result_p->replay_errors++;
+              else lat_record(&result_p->lat[OP_CLOSE], op_start);
+              break;
+
+            case TRACE_UNLINK:
+              replay_path(path, rt->paths[r->path_id]);
+              rc = prm.use_fuse ? unlink(path) : glfs_unlink(fs, path);
+              if (rc < OK && errno == EISDIR) rc = prm.use_fuse ? rmdir(path) : glfs_rmdir(fs, path);
+              if (rc < OK) {
+                result_p->replay_errors++;
+                break;
+              }
+              lat_record(&result_p->lat[OP_UNLINK], op_start);
+              result_p->files_deleted++;
+              live_add(&result_p->live->files_deleted, 1);
+              break;
+
+            case TRACE_STAT:
+            case TRACE_MKDIR:
+              replay_path(path, rt->paths[r->path_id]);
+              if (r->op == TRACE_STAT) {
+                rc = prm.use_fuse ? stat(path, &st) : glfs_stat(fs, path, &st);
+              } else {
+                rc = prm.use_fuse ? mkdir(path, 0755) : glfs_mkdir(fs, path, 0755);
+                if (rc < OK && errno == ENOENT) {
+                  make_parent_dir(fs, path);
+                  rc = prm.use_fuse ? mkdir(path, 0755) : glfs_mkdir(fs, path, 0755);
+                }
+                if (rc < OK && errno == EEXIST) rc = OK;
+              }
+              if (rc < OK) {
+                result_p->replay_errors++;
+                break;
+              }
+              lat_record(&result_p->lat[r->op == TRACE_STAT ? OP_STAT : OP_MKDIR], op_start);
+              result_p->metadata_ops++;
+              live_add(&result_p->live->metadata_ops, 1);
+              break;
+          }
+        }
+
+        /* close whatever the trace left open */
+        FOREACH(j, result_p->replay_count) {
+          f = &rt->files[rt->recs[result_p->replay_idx[j]].path_id];
+          if (f->opens > 0 && replay_close(result_p, f) < OK) result_p->replay_errors++;
+        }
+}
+
+/* tree workloads: rmtree, prepopulate, readdir and find.  the threads of a process share a pool of tasks, one per directory.
+ * each thread has its own deque of tasks and takes its newest one, so it works depth first and the pool stays small.
+ * when its deque is empty it steals the oldest task of another thread, which is usually the biggest subtree left,
+ * so no thread sits idle behind a slow directory.  GFAPI_MAX_INFLIGHT limits how many file operations
+ * the threads of a process have outstanding at once, to go easy on servers that are also doing other work */
+
+struct tree_task {
+  struct tree_task * parent;       /* rmtree: directory to remove after this one, NULL for GFAPI_BASEDIR itself */
+  int children;                    /* rmtree: subdirectories not yet removed, plus 1 until this one has been listed */
+  int tree_thread, dir_index;      /* prepopulate and readdir: leaf directory dir_index of thread tree_thread */
+  int depth;                       /* rmtree and find: levels below GFAPI_BASEDIR */
+  char path[];                     /* rmtree and find: this directory */
+};
+
+struct task_deque {
+  pthread_mutex_t lock;
+  struct tree_task ** tasks;       /* tasks[head] to tasks[tail-1], oldest first */
+  int head, tail, size;
+} __attribute__((aligned(CACHE_LINE)));
+
+static struct task_deque * tree_deques = NULL;  /* one per thread of this process */
+static int tree_pending;           /* tasks queued or being worked on, the threads stop when there are none */
+static sem_t tree_inflight;        /* GFAPI_MAX_INFLIGHT slots */
+static int tree_inflight_ready = 0;
+
+static inline void inflight_get( void )
+{
+        if (prm.max_inflight) while (sem_wait(&tree_inflight) < OK && errno == EINTR) ;
+}
+
+static inline void inflight_put( void )
+{
+        if (prm.max_inflight) sem_post(&tree_inflight);
+}
+
+struct tree_task * tree_task_new( const char * path, struct tree_task * parent, int depth )
+{
+        struct tree_task * task = (struct tree_task * )malloc(sizeof(struct tree_task) + strlen(path) + 1);
+
+        if (!task) scallerr("malloc tree task");
+        task->parent = parent;
+        task->children = 1;
+        task->tree_thread = task->dir_index = 0;
+        task->depth = depth;
+        strcpy(task->path, path);
+        return task;
+}
+
+void tree_push( int t, struct tree_task * task )
+{
+        struct task_deque * q = &tree_deques[t];
+
+        __atomic_add_fetch(&tree_pending, 1, __ATOMIC_ACQ_REL);
+        pthread_mutex_lock(&q->lock);
+        if (q->tail == q->size) {
+          if (q->head > q->size / 2) {
+            memmove(q->tasks, q->tasks + q->head, (q->tail - q->head) * sizeof(struct tree_task * ));
+            q->tail -= q->head;
+            q->head = 0;
+          } else {
+            q->size = q->size ? q->size * 2 : 256;
+            q->tasks = (struct tree_task ** )realloc(q->tasks, q->size * sizeof(struct tree_task * ));
+            if (!q->tasks) scallerr("realloc tree tasks");
+          }
+        }
+        q->tasks[q->tail++] = task;
+        pthread_mutex_unlock(&q->lock);
+}
+
+/* newest task of thread t, or else the oldest task of the next thread that has one */
+
+struct tree_task * tree_take( gfapi_result_t * result_p, int t )
+{
+        struct task_deque * q;
+        struct tree_task * task = NULL;
+        int j, v;
+
+        FOREACH(j, prm.threads_per_proc) {
+          v = (t + j) % prm.threads_per_proc;
+          q = &tree_deques[v];
+          if (__atomic_load_n(&q->tail, __ATOMIC_RELAXED) == __atomic_load_n(&q->head, __ATOMIC_RELAXED)) continue;
+          pthread_mutex_lock(&q->lock);
+          if (q->tail > q->head) task = (v == t) ? q->tasks[--q->tail] : q->tasks[q->head++];
+          if (q->head == q->tail) q->head = q->tail = 0;
+          pthread_mutex_unlock(&q->lock);
+          if (task) {
+            result_p->tree_tasks++;
+            if (v != t) result_p->tree_steals++;
+            return task;
+          }
+        }
+        return NULL;
+}
+
+/* with GFAPI_PROCESSES, each worker process takes the entries of GFAPI_BASEDIR whose names hash to it */
+
+static inline int tree_entry_mine( struct tree_task * task, const char * name )
+{
+        return task->depth > 0 || prm.processes == 1 || path_hash(name) % prm.processes == (uint32_t )prm.proc_num;
+}
+
+/* one fewer child of task is left, remove it when none are, and then its parent if that was the last child there */
+
+void rmtree_release( gfapi_result_t * result_p, struct tree_task * task )
+{
+        struct tree_task * parent;
+        uint64_t t0;
+        int rc;
+
+        while (task && __atomic_sub_fetch(&task->children, 1, __ATOMIC_ACQ_REL) == 0) {
+          parent = task->parent;
+          if (parent) {
+            t0 = getmono_ns();
+            inflight_get();
+            rc = prm.use_fuse ? rmdir(task->path) : glfs_rmdir(result_p->fs, task->path);
+            inflight_put();
+            if (rc < OK && errno != ENOENT) scallerr(task->path);
+            lat_record(&result_p->lat[OP_RMDIR], t0);
+            result_p->dirs_removed++;
+          }
+          free(task);
+          task = parent;
+        }
+}
+
+/* list one directory with readdirp, unlink its files and queue its subdirectories */
+
+void rmtree_dir( gfapi_result_t * result_p, int t, struct tree_task * task )
+{
+        glfs_t * fs = result_p->fs;
+        char entpath[PATH_MAX];
+        struct stat st;
+        struct dirent de, * de_p;
+        DIR * dir_p = NULL;
+        glfs_fd_t * glfs_dir_p = NULL;
+        uint64_t readdir_ns = 0, t0;
+        int rc, is_dir;
+
+        t0 = getmono_ns();
+        inflight_get();
+        if (prm.use_fuse) dir_p = opendir(task->path);
+        else glfs_dir_p = glfs_opendir(fs, task->path);
+        inflight_put();
+        if (!dir_p && !glfs_dir_p) {
+          if (errno != ENOENT) scallerr(task->path);
+          rmtree_release(result_p, task);
+          return;
+        }
+        for (;;) {
+          inflight_get();
+          if (prm.use_fuse) {
+            errno = 0;
+            de_p = readdir(dir_p);
+            if (!de_p && errno) scallerr("readdir");
+          } else {
+            rc = glfs_readdirplus_r(glfs_dir_p, &st, &de, &de_p);
+            if (rc) scallerr("glfs_readdirplus_r");
+          }
+          inflight_put();
+          readdir_ns += getmono_ns() - t0;
+          if (!de_p) break;
+          if (strcmp(de_p->d_name, ".") && strcmp(de_p->d_name, "..") &&
+              tree_entry_mine(task, de_p->d_name)) {
+            snprintf(entpath, sizeof(entpath), "%s/%s", task->path, de_p->d_name);
+            if (prm.use_fuse && de_p->d_type == DT_UNKNOWN) {
+              if (lstat(entpath, &st) < OK) scallerr(entpath);
+              is_dir = S_ISDIR(st.st_mode);
+            } else {
+              is_dir = prm.use_fuse ? (de_p->d_type == DT_DIR) : S_ISDIR(st.st_mode);
+            }
+            if (is_dir) {
+              __atomic_add_fetch(&task->children, 1, __ATOMIC_ACQ_REL);
+              tree_push(t, tree_task_new(entpath, task, task->depth + 1));
+            } else {
+              t0 = getmono_ns();
+              inflight_get();
+              rc = prm.use_fuse ? unlink(entpath) : glfs_unlink(fs, entpath);
+              inflight_put();
+              if (rc < OK && errno != ENOENT) scallerr(entpath);
+              lat_record(&result_p->lat[OP_UNLINK], t0);
+              result_p->files_deleted++;
+              live_add(&result_p->live->files_deleted, 1);
+            }
+          }
+          t0 = getmono_ns();
+        }
+        /* readdir_ns already holds the final empty readdir, only the closedir is added to it */
+        t0 = getmono_ns();
+        rc = prm.use_fuse ? closedir(dir_p) : glfs_closedir(glfs_dir_p);
+        if (rc < OK) scallerr(prm.use_fuse ? "closedir" : "glfs_closedir");
+        lat_record_ns(&result_p->lat[OP_READDIR], readdir_ns + getmono_ns() - t0);
+        rmtree_release(result_p, task);
+}
+
+/* create and write the files that one leaf directory of thread task->tree_thread holds, 
+ * with the names and sizes that a sequential write by that thread would have given them */
+
+void prepopulate_dir( gfapi_result_t * result_p, struct tree_task * task, char * buf, content_gen_t * gen, uint64_t * rnd_state_p )
+{
+        glfs_t * fs = result_p->fs;
+        glfs_fd_t * glfs_fd_p = NULL;
+        char path[1024];
+        int filenum, last, fd = -1, rc, size_class, fsz_class;
+        int flags = O_WRONLY|O_CREAT|O_TRUNC|prm.o_direct|prm.o_sync;
+        uint64_t file_size, file_done, op_start;
+        sync_state_t ss;
+        unsigned xfer;
+        ssize_t n;
+
+        filenum = task->dir_index * prm.files_per_dir;
+        last = filenum + prm.files_per_dir < prm.filecount ? filenum + prm.files_per_dir : prm.filecount;
+        for (; filenum < last; filenum++) {
+          get_next_path(filenum, prm.files_per_dir, task->tree_thread, prm.thrd_basedir, prm.prefix, path);
+          op_start = getmono_ns();
+          inflight_get();
+          if (prm.use_fuse) {
+            fd = open(path, flags, 0666);
+            if (fd < OK && errno == ENOENT) {
+              result_p->dirs_created += make_parent_dir(fs, path);
+              fd = open(path, flags, 0666);
+            }
+            if (fd < OK) scallerr(path);
+          } else {
+            glfs_fd_p = glfs_creat(fs, path, flags, 0666);
+            if (!glfs_fd_p && errno == ENOENT) {
+              result_p->dirs_created += make_parent_dir(fs, path);
+              glfs_fd_p = glfs_creat(fs, path, flags, 0666);
+            }
+            if (!glfs_fd_p) scallerr(path);
+          }
+          inflight_put();
+          op_start = lat_record(&result_p->lat[OP_CREATE], op_start);
+          ss.records = 0;
+          ss.last_ns = op_start;
+          file_size = file_bytes(task->tree_thread, filenum, &fsz_class);
+          for (file_done = 0; file_done < file_size; file_done += n) {
+            xfer = next_record_size(rnd_state_p, &size_class);
+            if (xfer > file_size - file_done) xfer = file_size - file_done;
+            if (prm.gen_content) fill_record(gen, buf, xfer);
+            inflight_get();
+            n = prm.use_fuse ? write(fd, buf, xfer) : glfs_write(glfs_fd_p, buf, xfer, 0);
+            inflight_put();
+            if (n < xfer) scallerr(prm.use_fuse ? "write" : "glfs_write");
+            op_start = lat_record(&result_p->lat[OP_WRITE], op_start);
+            if (prm.sync_mode == SYNC_FSYNC || prm.sync_mode == SYNC_FDATASYNC)
+              op_start = periodic_sync(result_p, &ss, fd, glfs_fd_p, 1, op_start);
+            count_request(result_p, size_class, n);
+          }
+          inflight_get();
+          if (prm.fsync_at_close) {
+            rc = prm.use_fuse ? fsync(fd) : glfs_fsync(glfs_fd_p);
+            if (rc) scallerr(prm.use_fuse ? "fsync" : "glfs_fsync");
+            op_start = lat_record(&result_p->lat[OP_FSYNC], op_start);
+          }
+          rc = prm.use_fuse ? close(fd) : glfs_close(glfs_fd_p);
+          inflight_put();
+          if (rc) scallerr(prm.use_fuse ? "close" : "glfs_close");
+          lat_record(&result_p->lat[OP_CLOSE], op_start);
+          result_p->files_written++;
+          result_p->fsz_class_files[fsz_class]++;
+          live_add(&result_p->live->files_written, 1);
+        }
+        free(task);
+}
+
+/* what getdents64 returns, glibc only declares it in newer versions */
+
+struct linux_dirent64 {
+  uint64_t d_ino;
+  int64_t d_off;
+  unsigned short d_reclen;
+  unsigned char d_type;
+  char d_name[];
+};
+
+/* readdir and find: list one directory in as few calls as possible, with glfs_readdirplus_r or, on FUSE, 
+ * getdents64 into the thread's buffer.  GFAPI_READDIR_STAT stats every entry, which is left out of the listing time.
+ * find queues subdirectories on thread t's deque.  returns the number of entries, not counting . and .. */
+
+uint64_t list_dir( gfapi_result_t * result_p, int t, struct tree_task * task, const char * dir, char * buf )
+{
+        glfs_t * fs = result_p->fs;
+        char entpath[PATH_MAX];
+        struct stat st;
+        struct dirent de, * de_p;
+        struct linux_dirent64 * d;
+        glfs_fd_t * glfs_dir_p = NULL;
+        uint64_t entries = 0, listing_ns = 0, t0;
+        long nread = 0, pos = 0;
+        int fd = -1, rc, dtype, c;
+        const char * name;
+
+        t0 = getmono_ns();
+        if (prm.use_fuse) fd = open(dir, O_RDONLY|O_DIRECTORY);
+        else glfs_dir_p = glfs_opendir(fs, dir);
+        if (fd < OK && !glfs_dir_p) scallerr(dir);
+        for (;;) {
+          if (prm.use_fuse) {
+            if (pos >= nread) {
+              nread = syscall(SYS_getdents64, fd, buf, prm.readdir_bytes);
+              if (nread < 0) scallerr("getdents64");
+              pos = 0;
+            }
+            if (nread == 0) break;
+            d = (struct linux_dirent64 * )(buf + pos);
+            pos += d->d_reclen;
+            name = d->d_name;
+            dtype = d->d_type;
+          } else {
+            rc = glfs_readdirplus_r(glfs_dir_p, &st, &de, &de_p);
+            if (rc) scallerr("glfs_readdirplus_r");
+            if (!de_p) break;
+            name = de_p->d_name;
+            dtype = S_ISDIR(st.st_mode) ? DT_DIR : DT_REG;
+          }
+          if (!strcmp(name, ".") || !strcmp(name, "..")) continue;
+          if (task && !tree_entry_mine(task, name)) continue;
+          listing_ns += getmono_ns() - t0;
+          entries++;
+          if (prm.readdir_stat || (task && dtype == DT_UNKNOWN)) {
+            snprintf(entpath, sizeof(entpath), "%s/%s", dir, name);
+            t0 = getmono_ns();
+            rc = prm.use_fuse ? lstat(entpath, &st) : glfs_lstat(fs, entpath, &st);
+            if (rc < OK) scallerr(entpath);
+            lat_record(&result_p->lat[OP_STAT], t0);
+            if (dtype == DT_UNKNOWN) dtype = S_ISDIR(st.st_mode) ? DT_DIR : DT_REG;
+          }
+          if (task && dtype == DT_DIR) {
+            snprintf(entpath, sizeof(entpath), "%s/%s", dir, name);
+            tree_push(t, tree_task_new(entpath, NULL, task->depth + 1));
+          }
+          t0 = getmono_ns();
+        }
+        rc = prm.use_fuse ? close(fd) : glfs_closedir(glfs_dir_p);
+        if (rc < OK) scallerr(prm.use_fuse ? "close" : "glfs_closedir");
+        listing_ns += getmono_ns() - t0;
+        lat_record_ns(&result_p->lat[OP_READDIR], listing_ns);
+        for (c = 0; c < DIRSZ_CLASSES - 1 && entries > ((uint64_t )DIRSZ_SMALLEST << (2 * c)); c++) ;
+        result_p->dirsz_dirs[c]++;
+        result_p->dirsz_entries[c] += entries;
+        result_p->dirsz_ns[c] += listing_ns;
+        result_p->entries_listed += entries;
+        live_add(&result_p->live->metadata_ops, entries);
+        return entries;
+}
+
+/* queue the first tasks of a phase.  rmtree and find start from GFAPI_BASEDIR and find the rest as they go, 
+ * prepopulate and readdir know every leaf directory up front and deal them out round-robin */
+
+void tree_setup( void )
+{
+        int t, tt, d, dirs, n = 0;
+        struct tree_task * task;
+
+        if (!tree_deques) {
+          if (posix_memalign((void ** )&tree_deques, CACHE_LINE, prm.threads_per_proc * sizeof(struct task_deque)))
+            scallerr("posix_memalign tree deques");
+          memset(tree_deques, 0, prm.threads_per_proc * sizeof(struct task_deque));
+          FOREACH(t, prm.threads_per_proc) pthread_mutex_init(&tree_deques[t].lock, NULL);
+        }
+        if (tree_inflight_ready) sem_destroy(&tree_inflight);
+        tree_inflight_ready = (prm.max_inflight > 0);
+        if (tree_inflight_ready && sem_init(&tree_inflight, 0, prm.max_inflight) < OK) scallerr("sem_init");
+        tree_pending = 0;
+        if (prm.workload_type == WL_RMTREE || prm.workload_type == WL_FIND) {
+          tree_push(0, tree_task_new(prm.thrd_basedir, NULL, 0));
+          return;
+        }
+        dirs = (prm.filecount + prm.files_per_dir - 1) / prm.files_per_dir;
+        FOREACH(tt, prm.tree_threads) FOREACH(d, dirs) {
+          if ((tt * dirs + d) % prm.processes != prm.proc_num) continue;
+          task = tree_task_new("", NULL, 0);
+          task->tree_thread = tt;
+          task->dir_index = d;
+          tree_push(n++ % prm.threads_per_proc, task);
+        }
+}
+
+/* each thread works until no task is queued or running anywhere in its process, 
+ * a running rmtree task may still queue more subdirectories until it finishes */
+
+void tree_run( gfapi_result_t * result_p, char * buf, content_gen_t * gen, uint64_t * rnd_state_p )
+{
+        int t = result_p->thread_num % prm.threads_per_proc;
+        struct tree_task * task;
+        char dir[1024];
+
+        while (__atomic_load_n(&tree_pending, __ATOMIC_ACQUIRE) > 0) {
+          task = tree_take(result_p, t);
+          if (!task) {
+            sleep_for_usec(100);
+            continue;
+          }
+          switch (prm.workload_type) {
+            case WL_RMTREE:
+              rmtree_dir(result_p, t, task);
+              break;
+            case WL_PREPOPULATE:
+              prepopulate_dir(result_p, task, buf, gen, rnd_state_p);
+              break;
+            case WL_READDIR:
+              get_next_path(task->dir_index * prm.files_per_dir, prm.files_per_dir, task->tree_thread, 
+                            prm.thrd_basedir, prm.prefix, dir);
+              list_dir(result_p, t, NULL, dirname(dir), buf);
+              free(task);
+              break;
+            case WL_FIND:
+              list_dir(result_p, t, task, task->path, buf);
+              free(task);
+              break;
+          }
+          __atomic_sub_fetch(&tree_pending, 1, __ATOMIC_ACQ_REL);
+        }
+}
+
+/* CPU and NUMA placement.  topology comes from sysfs and buffers are bound with the mbind() system call, 
+ * so libnuma is not needed */
+
+static int numa_nodes = 1;         /* highest node number + 1, 1 if the kernel has no NUMA */
+static cpu_set_t node_cpus[MAX_NUMA_NODES];
+
+/* parse a list like "0-3,8,10-11" into out[] in order, return the number of entries or -1 if it is malformed */
+
+int parse_int_list( const char * str, int * out, int max )
+{
+        const char * p = str;
+        char * end;
+        long lo, hi, v;
+        int n = 0;
+
+        while (*p) {
+          lo = strtol(p, &end, 10);
+          if (end == p || lo < 0) return -1;
+          hi = lo;
+          p = end;
+          if (*p == '-') {
+            hi = strtol(p + 1, &end, 10);
+            if (end == p + 1 || hi < lo) return -1;
+            p = end;
+          }
+          for (v = lo; v <= hi; v++) {
+            if (n == max) return -1;
+            out[n++] = (int )v;
+          }
+          if (*p == ',') p++;
+          else if (*p) return -1;
+        }
+        return n;
+}
+
+/* format a CPU set as a list like "0-3,8" */
+
+void cpuset_str( const cpu_set_t * set, char * buf, size_t len )
+{
+        int cpu, first = -1, n = 0;
+
+        buf[0] = 0;
+        for (cpu = 0; cpu <= CPU_SETSIZE; cpu++) {
+          int in = cpu < CPU_SETSIZE && CPU_ISSET(cpu, set);
+          if (in && first < 0) first = cpu;
+          if (!in && first >= 0) {
+            if (n > 0 && (size_t )n < len) n += snprintf(buf + n, len - n, ",");
+            if ((size_t )n < len) 
+              n += (first == cpu - 1) ? snprintf(buf + n, len - n, "%d", first) : 
+                                        snprintf(buf + n, len - n, "%d-%d", first, cpu - 1);
+            first = -1;
+          }
+        }
+}
+
+void numa_topology_init( void )
+{
+        char path[100], line[4096];
+        static int cpus[CPU_SETSIZE];
+        int n, j, node;
+        FILE * f;
+
+        numa_nodes = 0;
+        FOREACH(node, MAX_NUMA_NODES) {
+          CPU_ZERO(&node_cpus[node]);
+          sprintf(path, "/sys/devices/system/node/node%d/cpulist", node);
+          f = fopen(path, "r");
+          if (!f) continue;
+          if (fgets(line, sizeof(line), f)) {
+            line[strcspn(line, "\n")] = 0;
+            n = parse_int_list(line, cpus, CPU_SETSIZE);
+            FOREACH(j, n) CPU_SET(cpus[j], &node_cpus[node]);
+          }
+          fclose(f);
+          numa_nodes = node + 1;
+        }
+        if (numa_nodes == 0) {
+          numa_nodes = 1;
+          sched_getaffinity(0, sizeof(cpu_set_t), &node_cpus[0]);
+        }
+}
+
+int cpu_node( int cpu )
+{
+        int node;
+
+        if (cpu < 0) return -1;
+        FOREACH(node, numa_nodes) if (CPU_ISSET(cpu, &node_cpus[node])) return node;
+        return 0;
+}
+
+/* pin this worker thread as GFAPI_CPU_LIST and GFAPI_NUMA_POLICY ask, 
+ * return the node its buffer should come from, or -1 to leave that to the kernel */
+
+int place_thread( gfapi_result_t * result_p )
+{
+        cpu_set_t set;
+        int node = -1, rc;
+
+        CPU_ZERO(&set);
+        if (prm.numa_policy == NUMA_NODES) node = prm.numa_node_list[result_p->thread_num % prm.numa_node_count];
+        if (prm.cpu_count > 0) CPU_SET(prm.cpu_list[result_p->thread_num % prm.cpu_count], &set);
+        else if (node >= 0) set = node_cpus[node];
+        else if (prm.numa_policy == NUMA_LOCAL) set = node_cpus[cpu_node(sched_getcpu())]; /* stay on this node */
+        if (CPU_COUNT(&set) > 0) {
+          rc = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+          if (rc != OK) { errno = rc; scallerr("pthread_setaffinity_np"); }
+        }
+        if (prm.numa_policy == NUMA_LOCAL) node = cpu_node(sched_getcpu());
+        return node;
+}
+
+/* restrict a page-aligned buffer to one node and fault it in there */
+
+void bind_to_node( void * addr, size_t len, int node )
+{
+        unsigned long mask[MAX_NUMA_NODES / (8 * sizeof(unsigned long)) + 1] = {0};
+
+        mask[node / (8 * sizeof(unsigned long))] |= 1UL << (node % (8 * sizeof(unsigned long)));
+        if (syscall(__NR_mbind, addr, len, MPOL_BIND, mask, MAX_NUMA_NODES + 1, MPOL_MF_MOVE) < OK) scallerr("mbind");
+        memset(addr, 0, len);
+}
+
+/* which node the page at addr is on, -1 if the kernel won't say */
+
+int page_node( void * addr )
+{
+        int node = -1;
+
+        if (syscall(__NR_get_mempolicy, &node, NULL, 0, addr, MPOL_F_NODE | MPOL_F_ADDR) < OK) return -1;
+        return node;
+}
+
+/* charge the time since *phase_start_p to one part of the file's life, and start timing the next part.  
+ * a part that the end of the warm-up interrupted is only charged the time after it */
+
+static inline void file_phase_add( gfapi_result_t * result_p, int phase, uint64_t * phase_start_p, uint64_t now )
 {
-   int subdir = filenum / files_per_dir;
-   sprintf(next_fname, "%s/thrd%03d-d%04d/%s.%07d", base_dir, thread_num, subdir, prefix, filenum);
+  if (*phase_start_p < result_p->warm_done_ns) *phase_start_p = result_p->warm_done_ns;
+  result_p->file_phase_ns[phase] += now - *phase_start_p;
+  result_p->file_phase_count[phase]++;
+  *phase_start_p = now;
 }
 
 /* each thread runs code in this routine */
@@ -288,33 +3026,61 @@ void get_next_path( const int filenum, const int files_per_dir, const int thread
 void * gfapi_thread_run( void * void_result_p )
 {
   gfapi_result_t * result_p = (gfapi_result_t * )void_result_p;
-  off_t * random_offsets;
+  glfs_t * fs = result_p->fs;
+  offset_perm_t perm;
+  uint64_t rnd_state = prm.seed + result_p->thread_num;
+  uint64_t ops;
   char ready_path[1024] = {0}, hostnamebuf[1024] = {0}, pidstr[100] = {0}, threadstr[100] = {0};
   int ready_fd;
   glfs_fd_t * ready_fd_p;
   glfs_fd_t * glfs_fd_p = NULL;
   int fd = -1;
-  int rc, k;
+  int rc, k, filenum;
   int sec;
   struct stat st = {0};
   char next_fname[1024] = {0};
   int create_flags = O_WRONLY|O_EXCL|O_CREAT;
   off_t offset;
-  unsigned io_count;
-  int bytes_xferred;
+  unsigned io_count, xfer;
+  uint64_t file_size, file_done;
+  int size_class, fsz_class;
+  content_gen_t gen;
+  ssize_t bytes_xferred;
   char * buf;
+  uint64_t op_start, phase_start, pace_sleep_ns;
+  aio_ctx_t aio_ctx;
+  struct iovec * iov = NULL;
+  int * iov_class = NULL;
+  sync_state_t sync_st;
+  pace_t io_pace, file_pace;
+  cpu_set_t allowed;
+  int buf_node;
+  struct rusage ru_end;
 
-  /* use same random offset sequence for all files */
+  /* pin before anything is allocated, so the thread's memory comes from where it will run */
 
-  if (prm.workload_type == WL_RNDWR || prm.workload_type == WL_RNDRD) {
-    random_offsets = random_offset_sequence( 
-                          (uint64_t )prm.filesz_kb*BYTES_PER_KB, prm.recsz*BYTES_PER_KB );
-  }
+  buf_node = place_thread(result_p);
+
+  /* use same random offset sequence for all files, different for each thread */
+
+  rnd_state = rnd_next(&rnd_state);
+  offset_perm_init(&perm, prm.records_per_file / prm.iov, rnd_next(&rnd_state));
+  if (prm.shared_layout == SHARED_RANDOM) offset_perm_init(&perm, prm.records_per_file, prm.seed);
+  gen.rnd_state = rnd_state ^ 0x636f6e74656e74ULL;
+  gen.id = ((uint64_t )gethostid() << 32) ^ ((uint64_t )getpid() << 16) ^ (uint64_t )result_p->thread_num;
+  gen.counter = (uint64_t )prm.phase_num << 48; /* unique blocks stay unique across phases */
+
+  /* build the directory tree before anyone starts, so file creates don't pay for directory misses */
+
+  if (prm.precreate_dirs && !prm.shared_layout &&
+      ((prm.workload_type == WL_SEQWR && !(prm.o_append|prm.o_overwrite)) || 
+       prm.workload_type == WL_CREATE || prm.workload_type == WL_MKDIR))
+    result_p->dirs_created = precreate_dirs(result_p);
 
   /* wait for the starting gun file, which should be in parent directory */
   /* it is invoker's responsibility to unlink the starting gun file before starting this program */
 
-  if (strlen(prm.starting_gun_file) > 0) {
+  if (strlen(prm.starting_gun_file) > 0 && prm.phase_num == 0) {
     static const int sg_create_flags = O_CREAT|O_EXCL|O_WRONLY;
     char ready_buf[1024] = {0};
 
@@ -344,7 +3110,7 @@ void * gfapi_thread_run( void * void_result_p )
         if (rc < OK) scallerr("ready path close");
       }
     } else {
-      ready_fd_p = glfs_creat(glfs_p, ready_path, sg_create_flags, 0644);
+      ready_fd_p = glfs_creat(fs, ready_path, sg_create_flags, 0644);
       if (!ready_fd_p) scallerr(ready_path);
       else {
         rc = glfs_close(ready_fd_p);
@@ -357,7 +3123,7 @@ void * gfapi_thread_run( void * void_result_p )
     printf("%s : ", now_str());
     printf("awaiting starting gun file %s\n", prm.starting_gun_file);
     FOREACH(sec, prm.starting_gun_timeout) {
-      rc = prm.use_fuse ? stat(prm.starting_gun_file, &st) : glfs_stat(glfs_p, prm.starting_gun_file, &st);
+      rc = prm.use_fuse ? stat(prm.starting_gun_file, &st) : glfs_stat(fs, prm.starting_gun_file, &st);
       if (prm.debug) printf("rc=%d errno=%d\n", rc, errno);
       if (rc != OK) {
         if (errno != ENOENT) scallerr(prm.use_fuse ? "stat" : "glfs_stat");
@@ -376,41 +3142,113 @@ void * gfapi_thread_run( void * void_result_p )
   }
 
   /* we can use page-aligned buffer regardless of whether O_DIRECT is used or not */
-  buf = memalign(PAGE_BOUNDARY, prm.bytes_to_xfer);
+  /* with asynchronous I/O, each in-flight request gets its own slice of the buffer */
+  /* so does each record of a vectored call */
+  buf = memalign(1 << PAGE_BOUNDARY, (size_t )prm.bytes_to_xfer * prm.qdepth * prm.iov);
   if (!buf) scallerr("posix_memalign");
+  if (buf_node >= 0) bind_to_node(buf, (size_t )prm.bytes_to_xfer * prm.qdepth * prm.iov, buf_node);
+  result_p->start_cpu = sched_getcpu();
+  result_p->buf_node = buf_node >= 0 ? page_node(buf) : -1;
+  pthread_getaffinity_np(pthread_self(), sizeof(allowed), &allowed);
+  cpuset_str(&allowed, result_p->allowed_cpus, sizeof(result_p->allowed_cpus));
+  if (prm.qdepth > 1) aio_init(&aio_ctx, prm.qdepth, buf);
+  if (prm.iov > 1) {
+    iov = (struct iovec * )calloc(prm.iov, sizeof(struct iovec));
+    iov_class = (int * )calloc(prm.iov, sizeof(int));
+    if (!iov || !iov_class) scallerr("calloc iovec");
+    FOREACH(k, prm.iov) iov[k].iov_base = buf + (size_t )k * prm.bytes_to_xfer;
+  }
+  if (strlen(prm.trace_file) > 0 && prm.workload_type != WL_REPLAY) {
+    result_p->trace = (trace_buf_t * )calloc(1, sizeof(trace_buf_t));
+    if (!result_p->trace) scallerr("calloc trace");
+    result_p->trace->max = prm.trace_max_ops / prm.threads_per_proc;
+  }
+
+  /* release all threads in all local processes at once */
+
+  rc = pthread_barrier_wait(&proc_shared->start_barrier);
+  if (rc != OK && rc != PTHREAD_BARRIER_SERIAL_THREAD) { errno = rc; scallerr("pthread_barrier_wait"); }
 
   /* open the file */
 
   result_p->start_time = gettime_ns();
-  create_flags |= prm.o_direct;
+  getrusage(RUSAGE_THREAD, &result_p->ru_start);
+  if (result_p->thread_num % prm.threads_per_proc == 0) getrusage(RUSAGE_SELF, &proc_ru_start);
+  live_add(&result_p->live->start_ns, result_p->start_time);
+  create_flags |= prm.o_direct | prm.o_sync;
   if (prm.o_append|prm.o_overwrite) create_flags &= ~(O_EXCL|O_CREAT);
-  FOREACH(k, prm.filecount) {
+  if (prm.duration) result_p->deadline_ns = getmono_ns() + (uint64_t )prm.duration * 1000000000ULL;
+  if (prm.warmup_ns || prm.warmup_ops) {
+    /* a timed run lasts GFAPI_DURATION from the end of the warm-up */
+    result_p->warming = 1;
+    result_p->warm_end_ns = getmono_ns() + prm.warmup_ns;
+    if (prm.duration) result_p->deadline_ns = (uint64_t )-1;
+  }
+  op_start = getmono_ns();
+  pace_init(&io_pace, prm.target_iops, op_start, result_p->thread_num, prm.threads_per_proc * prm.processes);
+  pace_init(&file_pace, prm.target_files_per_sec, op_start, result_p->thread_num, prm.threads_per_proc * prm.processes);
+  if (prm.workload_type == WL_REPLAY) replay_run(result_p, buf, &gen);
+  else if (prm.workload_type >= WL_FIRST_TREE) tree_run(result_p, buf, &gen, &rnd_state);
+  else for (k = 0; (prm.duration ? (getmono_ns() < result_p->deadline_ns) : (k < prm.filecount)) && !measure_check(result_p); k++) {
    int workload = prm.workload_type;
    if (workload == WL_SEQRDWRMIX) {
-     float rndsample = (float )(random() % 100);
+     float rndsample = (float )(rnd_next(&rnd_state) % 100);
      workload = (rndsample > prm.rdpct) ? WL_SEQWR : WL_SEQRD;
      if (prm.debug) printf("workload %s\n", workload_description[workload]);
    }
-   get_next_path( k, prm.files_per_dir, result_p->thread_num, prm.thrd_basedir, prm.prefix, next_fname );
+   /* in a timed run, creates keep making new files, everything else cycles through the existing ones */
+   /* with GFAPI_DIST, operations on existing files pick each file from the distribution */
+   filenum = k;
+   if (!((workload == WL_SEQWR && !(prm.o_append|prm.o_overwrite)) || workload == WL_CREATE || workload == WL_MKDIR)) {
+     if (prm.duration && workload == WL_DELETE && k >= prm.filecount) break;
+     if (prm.file_dist.type != DIST_NONE && workload != WL_DELETE)
+       filenum = dist_next(&prm.file_dist, &rnd_state);
+     else if (prm.duration)
+       filenum = k % prm.filecount;
+   }
+   if (prm.shared_layout) {
+     /* shared-file I/O is always positional, so it uses the random-access paths */
+     shared_file_path(next_fname);
+     workload = (workload == WL_SEQWR || workload == WL_RNDWR) ? WL_RNDWR : WL_RNDRD;
+   } else {
+     get_next_path( filenum, prm.files_per_dir, result_p->thread_num, prm.thrd_basedir, prm.prefix, next_fname );
+   }
    if (prm.debug) printf("starting file %s\n", next_fname);
+   trace_set_path(result_p, next_fname);
+   op_start = file_pace.interval_ns ? pace_wait(&file_pace, result_p) : getmono_ns();
+   if (workload >= WL_FIRST_METADATA) {
+     ops = metadata_op(result_p, workload, next_fname, filenum, op_start);
+     result_p->metadata_ops += ops;
+     live_add(&result_p->live->metadata_ops, ops);
+     if (prm.usec_delay_per_file && ops) sleep_for_usec(prm.usec_delay_per_file);
+     continue;
+   }
    fd = -2;
    glfs_fd_p = NULL;
-   if (prm.use_fuse) {
+   phase_start = op_start;
+   if (prm.shared_layout) {
+     /* every thread opens the shared file, whichever gets there first creates it */
+     int shared_flags = (workload == WL_RNDWR ? O_WRONLY|O_CREAT|prm.o_sync : O_RDONLY) | prm.o_direct;
+     if (prm.use_fuse) {
+       fd = open(next_fname, shared_flags, 0666);
+       if (fd < OK) scallerr(next_fname);
+     } else {
+       glfs_fd_p = (shared_flags & O_CREAT) ? 
+         glfs_creat(fs, next_fname, shared_flags, 0666) : glfs_open(fs, next_fname, shared_flags);
+       if (!glfs_fd_p) scallerr(next_fname);
+     }
+   } else if (prm.use_fuse) {
      switch (workload) {
       case WL_DELETE:
         rc = unlink(next_fname);
+        if (rc < OK && errno == EISDIR) rc = rmdir(next_fname); /* made by mkdir workload */
         if (rc < OK && errno != ENOENT) scallerr(next_fname);
         break;
 
       case WL_SEQWR: 
         fd = open(next_fname, create_flags, 0666);
         if ((fd < OK) && (errno == ENOENT)) {
-          char subdir[1024];
-          strcpy(subdir, dirname(next_fname));
-          rc = mkdir(subdir, 0755);
-          if (rc < OK) scallerr(subdir);
-          /* we have to reconstruct filename because dirname() function sticks null into it */
-          get_next_path( k, prm.files_per_dir, result_p->thread_num, prm.thrd_basedir, prm.prefix, next_fname );
+          rc = make_parent_dir(fs, next_fname);
           fd = open(next_fname, create_flags, 0666);
         }
         if ((prm.workload_type == WL_SEQRDWRMIX) && (rc < OK) && (errno == EEXIST)) {
@@ -431,7 +3269,7 @@ void * gfapi_thread_run( void * void_result_p )
         break;
 
       case WL_RNDWR:
-        fd = open(next_fname, O_WRONLY|prm.o_direct);
+        fd = open(next_fname, O_WRONLY|prm.o_direct|prm.o_sync);
         if (fd < OK) scallerr(next_fname);
         break;
 
@@ -445,123 +3283,565 @@ void * gfapi_thread_run( void * void_result_p )
    } else {
      switch (workload) {
       case WL_DELETE:
-        rc = glfs_unlink(glfs_p, next_fname);
+        rc = glfs_unlink(fs, next_fname);
+        if (rc < OK && errno == EISDIR) rc = glfs_rmdir(fs, next_fname); /* made by mkdir workload */
         if (rc < OK && errno != ENOENT) scallerr(next_fname);
         break;
 
       case WL_SEQWR: 
         if (prm.o_append|prm.o_overwrite) {
-          glfs_fd_p = glfs_open(glfs_p, next_fname, create_flags );
+          glfs_fd_p = glfs_open(fs, next_fname, create_flags );
           if (!glfs_fd_p) scallerr(next_fname);
           if (prm.o_append) {
             rc = glfs_lseek( glfs_fd_p, 0, SEEK_END);
             if (rc < OK) scallerr(next_fname);
           }
         } else {
-          glfs_fd_p = glfs_creat(glfs_p, next_fname, create_flags, 0666 );
+          glfs_fd_p = glfs_creat(fs, next_fname, create_flags, 0666 );
           if ((!glfs_fd_p) && (errno == ENOENT)) {
-            char subdir[1024];
-            strcpy(subdir, dirname(next_fname));
-            rc = glfs_mkdir(glfs_p, subdir, 0755);
-            if (rc < OK) scallerr(subdir);
-            /* we have to reconstruct filename because dirname() function sticks null into it */
-            get_next_path( k, prm.files_per_dir, result_p->thread_num, prm.thrd_basedir, prm.prefix, next_fname );
-            glfs_fd_p = glfs_creat(glfs_p, next_fname, create_flags, 0666);
+            rc = make_parent_dir(fs, next_fname);
+            glfs_fd_p = glfs_creat(fs, next_fname, create_flags, 0666);
           }
           if ((prm.workload_type == WL_SEQRDWRMIX) && (rc < OK) && (errno == EEXIST)) {
-            rc = glfs_unlink(glfs_p, next_fname);
+            rc = glfs_unlink(fs, next_fname);
             if (rc < OK && errno != ENOENT) scallerr(next_fname);
-            glfs_fd_p = glfs_creat(glfs_p, next_fname, create_flags, 0666);
+            glfs_fd_p = glfs_creat(fs, next_fname, create_flags, 0666);
           }
           if (!glfs_fd_p) scallerr(next_fname);
         }
         break;
 
       case WL_SEQRD:
-        glfs_fd_p = glfs_open(glfs_p, next_fname, O_RDONLY|prm.o_direct);
+        glfs_fd_p = glfs_open(fs, next_fname, O_RDONLY|prm.o_direct);
         if (!glfs_fd_p) scallerr(next_fname);
         break;
 
       case WL_RNDWR:
-        glfs_fd_p = glfs_open(glfs_p, next_fname, O_WRONLY|prm.o_direct);
+        glfs_fd_p = glfs_open(fs, next_fname, O_WRONLY|prm.o_direct|prm.o_sync);
         if (!glfs_fd_p) scallerr(next_fname);
         break;
 
       case WL_RNDRD:
-        glfs_fd_p = glfs_open(glfs_p, next_fname, O_RDONLY|prm.o_direct);
+        glfs_fd_p = glfs_open(fs, next_fname, O_RDONLY|prm.o_direct);
         if (!glfs_fd_p) scallerr(next_fname);
         break;
 
       default: exit(NOTOK);
      }
    }
+   trace_add(result_p, workload == WL_DELETE ? TRACE_UNLINK : 
+                       (workload == WL_SEQWR && !(prm.o_append|prm.o_overwrite) && !prm.shared_layout) ? TRACE_CREATE :
+                       (workload == WL_SEQWR || workload == WL_RNDWR) ? TRACE_OPEN_WR : TRACE_OPEN_RD, 0, 0, op_start);
+   op_start = lat_record(&result_p->lat[workload == WL_DELETE ? OP_UNLINK : OP_OPEN], op_start);
+   file_phase_add(result_p, FILE_PHASE_OPEN, &phase_start, op_start);
    if (workload == WL_DELETE) {
      if (prm.usec_delay_per_file) sleep_for_usec(prm.usec_delay_per_file);
      result_p->files_deleted++;
+     live_add(&result_p->live->files_deleted, 1);
      continue;
    }
 
    /* perform the requested I/O operations */
 
    offset = 0;
+   file_done = 0;
+   file_size = file_bytes(result_p->thread_num, filenum, &fsz_class);
+   sync_st.records = 0;
+   sync_st.last_ns = op_start;
+   pace_sleep_ns = result_p->pace_sleep_ns;
    if (prm.debug) printf("io_requests = %ld\n", prm.io_requests);
-   FOREACH( io_count, prm.io_requests ) {
+   if (prm.qdepth > 1) 
+     io_count = async_io_loop(&aio_ctx, result_p, workload, fd, glfs_fd_p, &perm, &rnd_state, file_size, &gen);
+   else if (prm.iov > 1)
+     io_count = vector_io_loop(result_p, workload, fd, glfs_fd_p, iov, iov_class, &perm, &rnd_state, file_size, &io_pace, &gen, &sync_st);
+   else for (io_count = 0; (workload == WL_RNDWR || workload == WL_RNDRD) ? io_count < prm.io_requests : file_done < file_size; 
+             io_count++) {
+    if (result_p->deadline_ns && op_start >= result_p->deadline_ns) break;
+    if (measure_check(result_p)) break;
+    if (io_pace.interval_ns) op_start = pace_wait(&io_pace, result_p);
+    xfer = next_record_size(&rnd_state, &size_class);
+    if ((workload == WL_SEQWR || workload == WL_RNDWR) && prm.gen_content) fill_record(&gen, buf, xfer);
     if (workload == WL_SEQWR) {
-      offset += prm.bytes_to_xfer;
+      if (xfer > file_size - file_done) xfer = file_size - file_done;
+      offset += xfer;
       bytes_xferred = prm.use_fuse ?
-        write(fd, buf, prm.bytes_to_xfer) :
-        glfs_write(glfs_fd_p, buf, prm.bytes_to_xfer, 0);
-      if (bytes_xferred < prm.bytes_to_xfer) 
+        write(fd, buf, xfer) :
+        glfs_write(glfs_fd_p, buf, xfer, 0);
+      if (bytes_xferred < (ssize_t )xfer) 
                 scallerr(prm.use_fuse?"write":"glfs_write");
 
     } else if (workload == WL_SEQRD) {
-      offset += prm.bytes_to_xfer;
+      if (xfer > file_size - file_done) xfer = file_size - file_done;
+      offset += xfer;
       bytes_xferred = prm.use_fuse ? 
-        read(fd, buf, prm.bytes_to_xfer) :
-        glfs_read(glfs_fd_p, buf, prm.bytes_to_xfer, 0);
-      if (bytes_xferred < prm.bytes_to_xfer) 
+        read(fd, buf, xfer) :
+        glfs_read(glfs_fd_p, buf, xfer, 0);
+      if (bytes_xferred < (ssize_t )xfer) 
                 scallerr(prm.use_fuse?"read":"glfs_read");
 
     } else if (workload == WL_RNDWR) {
-      offset = random_offsets[io_count];
+      offset = prm.shared_layout ? shared_offset(&perm, shared_rank(result_p), io_count) :
+                                   next_random_offset(&perm, io_count, &rnd_state);
       bytes_xferred = prm.use_fuse ?
-        pwrite(fd, buf, prm.bytes_to_xfer, offset) :
-        glfs_pwrite(glfs_fd_p, buf, prm.bytes_to_xfer, offset, 0);
-      if (bytes_xferred < prm.bytes_to_xfer) 
+        pwrite(fd, buf, xfer, offset) :
+        glfs_pwrite(glfs_fd_p, buf, xfer, offset, 0);
+      if (bytes_xferred < (ssize_t )xfer) 
                 scallerr(prm.use_fuse?"pwrite":"glfs_pwrite");
 
-    } else if (workload == WL_RNDRD) {
-      offset = random_offsets[io_count];
+    } else { /* WL_RNDRD, seq-rdwrmix has become seq-wr or seq-rd for this file */
+      offset = prm.shared_layout ? shared_offset(&perm, shared_rank(result_p), io_count) :
+                                   next_random_offset(&perm, io_count, &rnd_state);
       bytes_xferred = prm.use_fuse ? 
-        pread(fd, buf, prm.bytes_to_xfer, offset) :
-        glfs_pread(glfs_fd_p, buf, prm.bytes_to_xfer, offset, 0);
-      if (bytes_xferred < prm.bytes_to_xfer) 
-                scallerr(prm.use_fuse?"pwrite":"glfs_pwrite");
+        pread(fd, buf, xfer, offset) :
+        glfs_pread(glfs_fd_p, buf, xfer, offset, 0);
+      if (bytes_xferred < (ssize_t )xfer) 
+                scallerr(prm.use_fuse?"pread":"glfs_pread");
     }
-    result_p->total_bytes_xferred += bytes_xferred;
+    trace_add(result_p, (workload == WL_SEQRD || workload == WL_RNDRD) ? TRACE_READ : TRACE_WRITE, 
+              (workload == WL_SEQRD || workload == WL_SEQWR) ? file_done : (uint64_t )offset, bytes_xferred, op_start);
+    op_start = lat_record(&result_p->lat[(workload == WL_SEQRD || workload == WL_RNDRD) ? OP_READ : OP_WRITE], op_start);
+    if ((workload == WL_SEQWR || workload == WL_RNDWR) && (prm.sync_mode == SYNC_FSYNC || prm.sync_mode == SYNC_FDATASYNC))
+      op_start = periodic_sync(result_p, &sync_st, fd, glfs_fd_p, 1, op_start);
+    file_done += bytes_xferred;
+    count_request(result_p, size_class, bytes_xferred);
     if (prm.debug) printf("offset %-20ld, io_count %-10u total_bytes_xferred %-20ld\n", 
                       offset, io_count, result_p->total_bytes_xferred);
    }
-   result_p->total_io_count += io_count;
+   op_start = getmono_ns();
+   /* waiting for GFAPI_TARGET_IOPS is not I/O, leave it to "other".  a warm-up that ended during the I/O 
+    * started the wait count again, and the I/O is only timed from then */
+   if (phase_start < result_p->warm_done_ns) {
+     phase_start = result_p->warm_done_ns;
+     pace_sleep_ns = 0;
+   }
+   phase_start += result_p->pace_sleep_ns - pace_sleep_ns;
+   file_phase_add(result_p, FILE_PHASE_IO, &phase_start, op_start);
 
    /* shut down file access */
 
    if ((workload == WL_SEQWR || workload == WL_RNDWR) && prm.fsync_at_close) {
      rc = prm.use_fuse ? fsync(fd) : glfs_fsync(glfs_fd_p);
      if (rc) scallerr(prm.use_fuse ? "fsync" : "glfs_fsync");
+     trace_add(result_p, TRACE_FSYNC, 0, 0, op_start);
+     op_start = lat_record(&result_p->lat[OP_FSYNC], op_start);
+     file_phase_add(result_p, FILE_PHASE_FSYNC, &phase_start, op_start);
    }
    rc = prm.use_fuse ? close(fd) : glfs_close(glfs_fd_p);
    if (rc) scallerr(prm.use_fuse ? "close" : "glfs_close");
+   trace_add(result_p, TRACE_CLOSE, 0, 0, op_start);
+   op_start = lat_record(&result_p->lat[OP_CLOSE], op_start);
+   file_phase_add(result_p, FILE_PHASE_CLOSE, &phase_start, op_start);
    if (prm.usec_delay_per_file) sleep_for_usec(prm.usec_delay_per_file);
-   if ((workload == WL_SEQWR) || (workload == WL_RNDWR))
+   if ((workload == WL_SEQWR) || (workload == WL_RNDWR)) {
      result_p->files_written++;
-   if ((workload == WL_SEQRD) || (workload == WL_RNDRD))
+     result_p->fsz_class_files[fsz_class]++;
+     live_add(&result_p->live->files_written, 1);
+   }
+   if ((workload == WL_SEQRD) || (workload == WL_RNDRD)) {
      result_p->files_read++;
+     result_p->fsz_class_files[fsz_class]++;
+     live_add(&result_p->live->files_read, 1);
+   }
   }
   result_p->end_time = gettime_ns();
+  getrusage(RUSAGE_THREAD, &ru_end);
+  cpu_usage_delta(&result_p->ru_start, &ru_end, &result_p->cpu);
+  if (result_p->warming) __atomic_sub_fetch(&threads_warming, 1, __ATOMIC_ACQ_REL);
+  result_p->min_elapsed = result_p->max_elapsed = result_p->thread_ns = result_p->end_time - result_p->start_time;
+  stonewall_finish(result_p);
+  live_add(&result_p->live->end_ns, result_p->end_time);
+  if (prm.qdepth > 1) aio_fini(&aio_ctx);
+  free(iov);
+  free(iov_class);
+  free(buf);
+  return NULL;
+}
+
+/* interval reporter thread, prints throughput over each GFAPI_REPORT_INTERVAL while the test runs */
+
+static pthread_mutex_t report_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t report_cv = PTHREAD_COND_INITIALIZER;
+static int report_done = 0;
+
+void * interval_report_run( void * void_live_array )
+{
+  live_stats_t * live_array = (live_stats_t * )void_live_array;
+  uint64_t * prev_bytes = (uint64_t * )calloc(prm.threads_per_proc, sizeof(uint64_t));
+  uint64_t * prev_ios = (uint64_t * )calloc(prm.threads_per_proc, sizeof(uint64_t));
+  uint64_t * prev_files = (uint64_t * )calloc(prm.threads_per_proc, sizeof(uint64_t));
+  uint64_t start_ns = getmono_ns(), prev_ns = start_ns, now_ns;
+  struct timespec wakeup;
+  int t, done = 0;
+
+  if (!prev_bytes || !prev_ios || !prev_files) scallerr("calloc interval counters");
+  clock_gettime(CLOCK_REALTIME, &wakeup);
+  while (!done) {
+    double interval_sec, agg_mbps = 0.0, agg_iops = 0.0, agg_fps = 0.0;
+    wakeup.tv_sec += prm.report_interval;
+    pthread_mutex_lock(&report_lock);
+    while (!report_done) {
+      if (pthread_cond_timedwait(&report_cv, &report_lock, &wakeup) == ETIMEDOUT) break;
+    }
+    done = report_done;
+    pthread_mutex_unlock(&report_lock);
+    if (done) break;
+
+    now_ns = getmono_ns();
+    interval_sec = (now_ns - prev_ns) / NSEC_PER_SEC;
+    FOREACH(t, prm.threads_per_proc) {
+      live_stats_t * l = &live_array[t];
+      uint64_t bytes = live_get(&l->bytes);
+      uint64_t ios = live_get(&l->ios);
+      uint64_t files = live_get(&l->files_written) + live_get(&l->files_read) + live_get(&l->files_deleted);
+      double mbps = (bytes - prev_bytes[t]) / (double )BYTES_PER_MB / interval_sec;
+      double iops = (ios - prev_ios[t]) / interval_sec;
+      double fps = (files - prev_files[t]) / interval_sec;
+      if (prm.threads_per_proc > 1)
+        printf("  interval thread %3d: %9.2f MB/s %10.2f rq/s %9.2f files/s\n", t, mbps, iops, fps);
+      agg_mbps += mbps; agg_iops += iops; agg_fps += fps;
+      prev_bytes[t] = bytes;
+      prev_ios[t] = ios;
+      prev_files[t] = files;
+    }
+    printf("interval at %8.1f sec: %9.2f MB/s %10.2f rq/s %9.2f files/s\n", 
+           (now_ns - start_ns) / NSEC_PER_SEC, agg_mbps, agg_iops, agg_fps);
+    fflush(stdout);
+    prev_ns = now_ns;
+  }
+  free(prev_bytes);
+  free(prev_ios);
+  free(prev_files);
+  return NULL;
+}
+
+/* rate sampler, run with GFAPI_WARMUP or GFAPI_STEADY_CV.  once every thread of this process has warmed up, 
+ * it samples the process's rate every GFAPI_SAMPLE_MS.  with GFAPI_STEADY_CV, when the standard deviation of the 
+ * last GFAPI_STEADY_WINDOW samples is less than that fraction of their mean, the rate has settled and every thread 
+ * of every process is told to stop.  the samples also give a confidence interval for the measured rate */
+
+struct rate_samples {
+  double * rates;
+  int count, size;
+  double min_cov;                  /* lowest coefficient of variation seen over a full window, -1 if none yet */
+  uint64_t start_ns, steady_ns;    /* monotonic time sampling started, and steady state was reached here, 0 if not */
+};
+static struct rate_samples samples = { NULL, 0, 0, -1.0, 0, 0 };
+
+/* MB moved for workloads that transfer data, otherwise operations done */
+
+static inline int samples_are_mb( void )
+{
+  return prm.workload_type == WL_REPLAY || (prm.workload_type < WL_FIRST_METADATA && prm.workload_type != WL_DELETE);
+}
+
+static double sample_total( live_stats_t * live_array )
+{
+  double total = 0.0;
+  int t;
+
+  FOREACH(t, prm.threads_per_proc) {
+    live_stats_t * l = &live_array[t];
+    if (samples_are_mb()) total += live_get(&l->bytes) / (double )BYTES_PER_MB;
+    else total += live_get(&l->ios) + live_get(&l->files_deleted) + live_get(&l->metadata_ops);
+  }
+  return total;
+}
+
+/* mean and sample standard deviation of n values */
+
+static void mean_stddev( const double * v, int n, double * mean_p, double * sd_p )
+{
+  double sum = 0.0, sq = 0.0;
+  int j;
+
+  FOREACH(j, n) sum += v[j];
+  *mean_p = sum / n;
+  FOREACH(j, n) sq += (v[j] - *mean_p) * (v[j] - *mean_p);
+  *sd_p = n > 1 ? sqrt(sq / (n - 1)) : 0.0;
+}
+
+void * sampler_run( void * void_live_array )
+{
+  live_stats_t * live_array = (live_stats_t * )void_live_array;
+  double prev_total = 0.0, total, mean, sd, cov;
+  uint64_t prev_ns = 0, now_ns, expected = 0;
+  struct timespec wakeup;
+  int done = 0;
+
+  free(samples.rates);
+  memset(&samples, 0, sizeof(samples));
+  samples.min_cov = -1.0;
+  clock_gettime(CLOCK_REALTIME, &wakeup);
+  while (!done) {
+    wakeup.tv_nsec += prm.sample_ms % 1000 * 1000000L;
+    wakeup.tv_sec += prm.sample_ms / 1000 + wakeup.tv_nsec / 1000000000L;
+    wakeup.tv_nsec %= 1000000000L;
+    pthread_mutex_lock(&report_lock);
+    while (!report_done) {
+      if (pthread_cond_timedwait(&report_cv, &report_lock, &wakeup) == ETIMEDOUT) break;
+    }
+    done = report_done;
+    pthread_mutex_unlock(&report_lock);
+    if (done || __atomic_load_n(&proc_shared->steady_ns, __ATOMIC_RELAXED)) break;
+    if (__atomic_load_n(&threads_warming, __ATOMIC_ACQUIRE) > 0) continue;
+
+    now_ns = getmono_ns();
+    total = sample_total(live_array);
+    if (prev_ns) {
+      if (samples.count == samples.size) {
+        samples.size = samples.size ? samples.size * 2 : 256;
+        samples.rates = (double * )realloc(samples.rates, samples.size * sizeof(double));
+        if (!samples.rates) scallerr("realloc rate samples");
+      }
+      samples.rates[samples.count++] = (total - prev_total) * NSEC_PER_SEC / (now_ns - prev_ns);
+    } else {
+      samples.start_ns = now_ns;
+    }
+    prev_ns = now_ns;
+    prev_total = total;
+    if (prm.steady_cv > 0.0 && samples.count >= prm.steady_window) {
+      mean_stddev(samples.rates + samples.count - prm.steady_window, prm.steady_window, &mean, &sd);
+      if (mean <= 0.0) continue;
+      cov = sd / mean;
+      if (samples.min_cov < 0.0 || cov < samples.min_cov) samples.min_cov = cov;
+      if (cov < prm.steady_cv) {
+        samples.steady_ns = now_ns;
+        __atomic_compare_exchange_n(&proc_shared->steady_ns, &expected, gettime_ns(), 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+        break;
+      }
+    }
+  }
   return NULL;
 }
 
+/* 95% two-sided Student t quantiles for 1 to 30 degrees of freedom */
+
+static const double t975[] = { 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228, 
+                               2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+                               2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042 };
+
+/* what this process's warm-up, steady state and rate samples came to.  neighbouring samples are correlated, so with 
+ * enough of them the interval comes from the means of 10 batches of consecutive samples instead of the samples */
+
+void print_measurement( void )
+{
+  const char * unit = samples_are_mb() ? "MB/s" : "ops/s";
+  double batch[10], mean, sd, half;
+  int n = samples.count, batches = n, per = 1, b, j;
+
+  if (prm.warmup_ops) printf("  warm-up: first "UINT64DFMT" operations of each thread not measured\n", prm.warmup_ops);
+  else if (prm.warmup_ns) printf("  warm-up: first %.2f sec of each thread not measured\n", prm.warmup_ns / NSEC_PER_SEC);
+  if (prm.steady_cv > 0.0) {
+    if (samples.steady_ns) 
+      printf("  steady state: reached after %.2f sec of measurement, last %d samples within CoV %.4f\n", 
+             (samples.steady_ns - samples.start_ns) / NSEC_PER_SEC, prm.steady_window, prm.steady_cv);
+    else if (__atomic_load_n(&proc_shared->steady_ns, __ATOMIC_RELAXED)) 
+      printf("  steady state: reached by another process\n");
+    else if (samples.min_cov >= 0.0) 
+      printf("  steady state: not reached, lowest CoV over %d samples was %.4f\n", prm.steady_window, samples.min_cov);
+    else printf("  steady state: not reached, fewer than %d samples\n", prm.steady_window);
+  }
+  if (n < 2) {
+    printf("  measured rate: %d samples of %d msec, too few for a confidence interval\n", n, prm.sample_ms);
+    return;
+  }
+  if (n >= 20) {
+    batches = 10;
+    per = n / batches;
+    FOREACH(b, batches) {
+      batch[b] = 0.0;
+      FOREACH(j, per) batch[b] += samples.rates[b * per + j];
+      batch[b] /= per;
+    }
+    mean_stddev(batch, batches, &mean, &sd);
+  } else {
+    mean_stddev(samples.rates, n, &mean, &sd);
+  }
+  half = t975[batches - 2 < 30 ? batches - 2 : 29] * sd / sqrt(batches);
+  printf("  measured rate: %.2f %s, 95%% confidence interval +/- %.2f (%.1f%%), from %d samples of %d msec", 
+         mean, unit, half, mean > 0.0 ? 100.0 * half / mean : 0.0, batches * per, prm.sample_ms);
+  if (per > 1) printf(" in %d batches", batches);
+  printf("\n");
+}
+
+/* allocate the live counters, in a named shared memory segment if GFAPI_STATS_SHM is set
+ * so monitors on this client can sample progress of all processes */
+
+live_stats_t * live_stats_create( int threads )
+{
+  int fd;
+  char * base;
+  size_t live_size = sizeof(struct live_stats_hdr) + (size_t )threads * sizeof(live_stats_t);
+  if (prm.stats_shm) {
+    sprintf(live_shm_name, "/gfapi_perf_test.%d", getpid());
+    fd = shm_open(live_shm_name, O_CREAT|O_EXCL|O_RDWR, 0644);
+    if (fd < OK) scallerr(live_shm_name);
+    if (ftruncate(fd, live_size) < OK) scallerr("ftruncate stats segment");
+    base = mmap(NULL, live_size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+  } else {
+    base = mmap(NULL, live_size, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_ANONYMOUS, -1, 0);
+  }
+  if (base == MAP_FAILED) scallerr("mmap stats segment");
+  live_hdr = (struct live_stats_hdr * )base;
+  live_hdr->pid = getpid();
+  live_hdr->threads = threads;
+  live_hdr->recsz_kb = prm.recsz;
+  strncpy(live_hdr->workload, prm.workload_str, sizeof(live_hdr->workload)-1);
+  live_hdr->version = LIVE_STATS_VERSION;
+  __atomic_store_n(&live_hdr->magic, LIVE_STATS_MAGIC, __ATOMIC_RELEASE);
+  return (live_stats_t * )(base + sizeof(struct live_stats_hdr));
+}
+
+void live_stats_set_state( int state )
+{
+  __atomic_store_n(&live_hdr->state, state, __ATOMIC_RELEASE);
+}
+
+/* mount one libgfapi instance, instances are started in parallel so big volumes don't serialize startup */
+
+void * glfs_instance_init_run( void * void_index )
+{
+  int index = (int )(intptr_t )void_index;
+  char logfilename[100];
+  glfs_t * fs;
+  int rc;
+
+  /* threads that libgfapi starts inherit this thread's CPU affinity */
+  if (CPU_COUNT(&prm.event_cpus) > 0) {
+    rc = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &prm.event_cpus);
+    if (rc != OK) { errno = rc; scallerr("pthread_setaffinity_np"); }
+  }
+
+  /* mount volume */
+  fs = glfs_new(prm.glfs_volname);
+  if (!fs) scallerr("ERROR: could not initialize Gluster volume mount with volname");
+  glfs_instances[index] = fs;
+
+  if (prm.instances > 1) sprintf(logfilename, "/tmp/glfs-%d.%d.log", getpid(), index);
+  else sprintf(logfilename, "/tmp/glfs-%d.log", getpid());
+  if (glfs_set_logging(fs, logfilename, prm.trclvl)) scallerr("set_logging");
+
+  if (glfs_set_volfile_server( fs, prm.glfs_transport, prm.glfs_hostname, prm.glfs_portnum ))
+      scallerr("ERROR: could not initialize gfapi mount");
+
+  if (glfs_init(fs)) scallerr("glfs_init");
+  return NULL;
+}
+
+/* print CPU cost per unit of work, which is what separates libgfapi from FUSE on a busy client */
+
+void print_cpu_usage( const char * label, const cpu_usage_t * c, gfapi_result_t * result_p )
+{
+  double cpu_sec = c->user_sec + c->sys_sec;
+  uint64_t files = result_p->files_written + result_p->files_read + result_p->files_deleted;
+  uint64_t ops = result_p->total_io_count + result_p->metadata_ops + result_p->files_deleted;
+
+  printf("  %s CPU: user %.3f sys %.3f sec", label, c->user_sec, c->sys_sec);
+  if (result_p->total_bytes_xferred > 0) 
+    printf(", %.3f CPU-sec/GB", cpu_sec * BYTES_PER_GB / result_p->total_bytes_xferred);
+  if (files > 0) printf(", %.1f CPU-usec/file", cpu_sec * 1000000.0 / files);
+  if (result_p->metadata_ops > 0) printf(", %.1f CPU-usec/metadata op", cpu_sec * 1000000.0 / result_p->metadata_ops);
+  printf("\n");
+  printf("  %s context switches: "UINT64DFMT" voluntary "UINT64DFMT" involuntary", label, c->nvcsw, c->nivcsw);
+  if (ops > 0) printf(", %.3f per op", (double )(c->nvcsw + c->nivcsw) / ops);
+  printf(", page faults: "UINT64DFMT" minor "UINT64DFMT" major\n", c->minflt, c->majflt);
+}
+
+/* with GFAPI_RECSZ or GFAPI_FSZ lists, show how much of the work each size class did */
+
+void print_size_classes( gfapi_result_t * result_p )
+{
+  int c;
+  uint64_t files = 0;
+
+  if (prm.rec_dist.count > 1 && result_p->total_io_count > 0) {
+    FOREACH(c, prm.rec_dist.count) 
+      printf("  record size "UINT64DFMT" KB: "UINT64DFMT" requests (%.1f%%) %9.2f MB/s %10.2f rq/s\n", prm.rec_dist.kb[c], 
+             result_p->rec_class_ios[c], 100.0 * result_p->rec_class_ios[c] / result_p->total_io_count,
+             result_p->rec_class_bytes[c] / (double )BYTES_PER_MB * NSEC_PER_SEC / result_p->elapsed_time,
+             result_p->rec_class_ios[c] * NSEC_PER_SEC / result_p->elapsed_time);
+  }
+  FOREACH(c, prm.fsz_dist.count) files += result_p->fsz_class_files[c];
+  if (prm.fsz_dist.count > 1 && files > 0) {
+    FOREACH(c, prm.fsz_dist.count) 
+      printf("  file size "UINT64DFMT" KB: "UINT64DFMT" files (%.1f%%) %9.2f files/s\n", prm.fsz_dist.kb[c], 
+             result_p->fsz_class_files[c], 100.0 * result_p->fsz_class_files[c] / files,
+             result_p->fsz_class_files[c] * NSEC_PER_SEC / result_p->elapsed_time);
+  }
+}
+
+/* where each thread's time went, summed over the files it worked on.  a phase's share of the time shows 
+ * whether the data path or the metadata path (create, fsync, close which flushes write-behind) dominates */
+
+void print_file_phases( gfapi_result_t * result_p )
+{
+  int ph;
+  uint64_t timed_ns = 0;
+
+  if (result_p->thread_ns == 0 || result_p->file_phase_count[FILE_PHASE_OPEN] == 0) return;
+  FOREACH(ph, FILE_PHASES) {
+    if (result_p->file_phase_count[ph] == 0) continue;
+    timed_ns += result_p->file_phase_ns[ph];
+    printf("  file phase %-6s %6.2f%% of thread time, mean %10.1f usec, %10.2f files/s per thread\n",
+           (ph == FILE_PHASE_OPEN && prm.workload_type == WL_DELETE) ? "unlink" : file_phase_names[ph], 100.0 * result_p->file_phase_ns[ph] / result_p->thread_ns,
+           result_p->file_phase_ns[ph] / 1000.0 / result_p->file_phase_count[ph],
+           result_p->file_phase_count[ph] * NSEC_PER_SEC / result_p->file_phase_ns[ph]);
+  }
+  if (result_p->thread_ns > timed_ns) 
+    printf("  file phase other  %6.2f%% of thread time (delays, pacing, loop overhead)\n", 
+           100.0 * (result_p->thread_ns - timed_ns) / result_p->thread_ns);
+}
+
+/* how the replay kept up with the trace.  lateness is only measured when GFAPI_REPLAY_SPEED is set */
+
+void print_replay( gfapi_result_t * result_p )
+{
+  double trace_sec = prm.replay->hdr->duration_ns / NSEC_PER_SEC;
+
+  printf("  replay: trace spans %.2f sec, replayed in %.2f sec", trace_sec, result_p->elapsed_time / NSEC_PER_SEC);
+  if (trace_sec > 0.0 && result_p->elapsed_time > 0) 
+    printf(" (%.2fx the original pace)", trace_sec * NSEC_PER_SEC / result_p->elapsed_time);
+  printf("\n");
+  if (result_p->paced_ops > 0)
+    printf("  replay lag: "UINT64DFMT" of "UINT64DFMT" ops more than %d msec behind trace time, mean %.1f usec, max %.1f usec\n",
+           result_p->late_ops, result_p->paced_ops, REPLAY_LATE_NS / 1000000, 
+           result_p->lag_sum_ns / 1000.0 / result_p->paced_ops, result_p->max_lag_ns / 1000.0);
+  if (result_p->replay_errors > 0) 
+    printf("  replay errors: "UINT64DFMT" operations failed\n", result_p->replay_errors);
+}
+
+/* what a tree walk did, and how evenly work-stealing spread it */
+
+void print_tree( gfapi_result_t * result_p )
+{
+  double sec = result_p->elapsed_time / NSEC_PER_SEC;
+
+  int c;
+
+  if (prm.workload_type == WL_RMTREE)
+    printf("  tree: "UINT64DFMT" files and "UINT64DFMT" directories removed, %.2f files/s, %.2f dirs/s\n", 
+           result_p->files_deleted, result_p->dirs_removed, result_p->files_deleted / sec, result_p->dirs_removed / sec);
+  else if (prm.workload_type == WL_READDIR || prm.workload_type == WL_FIND)
+    printf("  tree: "UINT64DFMT" directories and "UINT64DFMT" entries listed%s, %.2f dirs/s, %.2f entries/s\n", 
+           result_p->tree_tasks, result_p->entries_listed, prm.readdir_stat ? " and stat-ed" : "", 
+           result_p->tree_tasks / sec, result_p->entries_listed / sec);
+  else
+    printf("  tree: "UINT64DFMT" leaf directories filled, "UINT64DFMT" directories made\n", 
+           result_p->tree_tasks, result_p->dirs_created);
+  if (result_p->tree_tasks > 0)
+    printf("  work stealing: "UINT64DFMT" of "UINT64DFMT" directory tasks (%.1f%%) taken from other threads\n", 
+           result_p->tree_steals, result_p->tree_tasks, 100.0 * result_p->tree_steals / result_p->tree_tasks);
+  FOREACH(c, DIRSZ_CLASSES) {
+    if (result_p->dirsz_dirs[c] == 0) continue;
+    if (c < DIRSZ_CLASSES - 1) printf("  listing up to %6lu entries: ", (unsigned long )DIRSZ_SMALLEST << (2 * c));
+    else printf("  listing more entries:      ");
+    printf(UINT64DFMT" dirs, mean %.1f entries, %.1f usec/dir, %.3f usec/entry\n", result_p->dirsz_dirs[c],
+           (double )result_p->dirsz_entries[c] / result_p->dirsz_dirs[c], result_p->dirsz_ns[c] / 1000.0 / result_p->dirsz_dirs[c], 
+           result_p->dirsz_entries[c] ? result_p->dirsz_ns[c] / 1000.0 / result_p->dirsz_entries[c] : 0.0);
+  }
+}
+
 void print_result( gfapi_result_t * result_p )
 {
   float thru, files_thru, mb_transferred, pct_actual_reads;
@@ -569,12 +3849,15 @@ void print_result( gfapi_result_t * result_p )
 
   /* calculate and print stats */
 
-  if (result_p->thread_num < 0) printf("aggregate: "); else printf("thread %3d: ", result_p->thread_num);
+  if (result_p->thread_num >= 0) printf("thread %3d: ", result_p->thread_num);
+  else if (result_p->instance >= 0) printf("instance %d: ", result_p->instance);
+  else if (result_p->thread_num == -2) printf("all processes: ");
+  else printf("aggregate: ");
   result_p->elapsed_time = result_p->end_time - result_p->start_time;
   if (prm.debug) printf("start %ld end %ld elapsed %ld\n", result_p->start_time, result_p->end_time, result_p->elapsed_time);
   if (prm.debug) printf("  total byte count = "UINT64DFMT" total io count = "UINT64DFMT"\n", 
                      result_p->total_bytes_xferred, result_p->total_io_count );
-  mb_transferred = (float )result_p->total_io_count * prm.recsz / KB_PER_MB;
+  mb_transferred = (float )result_p->total_bytes_xferred / BYTES_PER_MB;
   thru = mb_transferred * NSEC_PER_SEC / result_p->elapsed_time ;
   files_done = result_p->files_written + result_p->files_read;
   files_thru = files_done * NSEC_PER_SEC / result_p->elapsed_time;
@@ -584,77 +3867,347 @@ void print_result( gfapi_result_t * result_p )
   if (result_p->files_written) printf("  files written = "UINT64DFMT"\n", result_p->files_written);
   if (result_p->files_read) printf("  files read = "UINT64DFMT"\n", result_p->files_read);
   printf("  files done = "UINT64DFMT"\n", files_done);
+  if (result_p->warming && result_p->thread_num >= 0) 
+    printf("  WARNING: warm-up never ended, these results include the warm-up\n");
+  else if (result_p->warming) 
+    printf("  WARNING: %d threads finished before their warm-up ended, these results include their warm-up\n", result_p->warming);
+  if (result_p->thread_num >= 0 && (prm.cpu_count > 0 || prm.numa_policy != NUMA_DEFAULT)) {
+    printf("  placement: started on cpu %d node %d, allowed cpus %s", 
+           result_p->start_cpu, cpu_node(result_p->start_cpu), result_p->allowed_cpus);
+    if (result_p->buf_node >= 0) printf(", buffer on node %d", result_p->buf_node);
+    printf("\n");
+  }
   if (prm.workload_type == WL_SEQRDWRMIX) {
     pct_actual_reads = 100.0 * result_p->files_read / files_done;
     printf("  fraction of reads = %6.2f%%\n", pct_actual_reads );
   }
   if (result_p->total_io_count > 0) printf("  I/O (record) transfers = "UINT64DFMT"\n", result_p->total_io_count);
   if (result_p->total_bytes_xferred > 0) printf("  total bytes = "UINT64DFMT"\n", result_p->total_bytes_xferred);
+  if (result_p->metadata_ops > 0) printf("  metadata ops = "UINT64DFMT"\n", result_p->metadata_ops);
+  if (result_p->dirs_created > 0 && prm.workload_type != WL_PREPOPULATE) printf("  directories pre-created = "UINT64DFMT"\n", result_p->dirs_created);
   printf("  elapsed time    = %-9.2f sec\n", result_p->elapsed_time/NSEC_PER_SEC);
+  if (result_p->thread_num < 0 && result_p->last_start_time > result_p->start_time)
+    printf("  start skew      = %-9.1f usec\n", (result_p->last_start_time - result_p->start_time) / 1000.0);
   if (thru > 0.0) printf("  throughput      = %-9.2f MB/sec\n", thru);
   if (files_thru > 0.0) printf("  file rate       = %-9.2f files/sec\n", files_thru);
-  if (thru > 0.0) printf("  IOPS            = %-9.2f (%s)\n", thru * 1024 / prm.recsz, workload_description[prm.workload_type]);
+  if (thru > 0.0) printf("  IOPS            = %-9.2f (%s)\n", 
+                         result_p->total_io_count * NSEC_PER_SEC / result_p->elapsed_time, workload_description[prm.workload_type]);
+  print_size_classes(result_p);
+  if (result_p->io_calls > 0) {
+    /* how much batching saves shows up as CPU and time per call against per record */
+    double cpu_usec = (result_p->cpu.user_sec + result_p->cpu.sys_sec) * 1000000.0;
+    printf("  vectored calls = "UINT64DFMT", %.2f records/call, %.2f calls/s, %.2f records/s\n", result_p->io_calls,
+           (double )result_p->total_io_count / result_p->io_calls, result_p->io_calls * NSEC_PER_SEC / result_p->elapsed_time,
+           result_p->total_io_count * NSEC_PER_SEC / result_p->elapsed_time);
+    printf("  vectored cost: %.1f worker CPU-usec/call, %.1f worker CPU-usec/record\n", 
+           cpu_usec / result_p->io_calls, cpu_usec / result_p->total_io_count);
+  }
+  if (result_p->metadata_ops > 0) 
+    printf("  metadata rate   = %-9.2f ops/sec (%s)\n", 
+           result_p->metadata_ops * NSEC_PER_SEC / result_p->elapsed_time, workload_description[prm.workload_type]);
+  if (prm.stonewall && result_p->sw_taken) {
+    printf("  stonewalled: %.2f MB/s %.2f rq/s %.2f files/s", result_p->sw_mbps, result_p->sw_iops, result_p->sw_fps);
+    if (result_p->thread_num >= 0) 
+      printf(" after "UINT64DFMT" files in %.2f sec", result_p->sw_files, result_p->sw_elapsed / NSEC_PER_SEC);
+    printf("\n");
+  }
+  if (prm.workload_type >= WL_FIRST_TREE) print_tree(result_p);
+  if (prm.workload_type == WL_REPLAY) print_replay(result_p);
+  else if (result_p->paced_ops > 0)
+    printf("  schedule: target %.2f/sec per thread, "UINT64DFMT" of "UINT64DFMT" ops more than one interval late, max lag %.1f usec\n",
+           prm.target_iops > 0.0 ? prm.target_iops : prm.target_files_per_sec,
+           result_p->late_ops, result_p->paced_ops, result_p->max_lag_ns / 1000.0);
+  if (result_p->thread_num < 0 && result_p->min_elapsed > 0)
+    printf("  completion imbalance = %.3f (max/min thread time, %.2f / %.2f sec)\n", 
+           (double )result_p->max_elapsed / result_p->min_elapsed, 
+           result_p->max_elapsed / NSEC_PER_SEC, result_p->min_elapsed / NSEC_PER_SEC);
+  print_file_phases(result_p);
+  print_cpu_usage("worker", &result_p->cpu, result_p);
+  if (result_p->proc_cpu.user_sec + result_p->proc_cpu.sys_sec > 0.0) {
+    /* the process total also counts libgfapi's event threads, which do most of the protocol work */
+    double other_sec = result_p->proc_cpu.user_sec + result_p->proc_cpu.sys_sec - result_p->cpu.user_sec - result_p->cpu.sys_sec;
+    print_cpu_usage("process", &result_p->proc_cpu, result_p);
+    printf("  %s CPU: %.3f sec\n", prm.use_fuse ? "non-worker threads" : "libgfapi event and other threads", 
+           other_sec > 0.0 ? other_sec : 0.0);
+  }
+  print_latencies(result_p);
 }
 
 void aggregate_result( gfapi_result_t * r_in_p, gfapi_result_t * r_out_p )
 {
+  int op;
+
   if (r_out_p->start_time == 0) r_out_p->start_time = (uint64_t )-1; /* positive infinity */
   if (r_out_p->start_time > r_in_p->start_time) r_out_p->start_time = r_in_p->start_time;
+  if (r_out_p->last_start_time < r_in_p->start_time) r_out_p->last_start_time = r_in_p->start_time;
+  if (r_out_p->last_start_time < r_in_p->last_start_time) r_out_p->last_start_time = r_in_p->last_start_time;
+  if (r_out_p->min_elapsed == 0 || r_out_p->min_elapsed > r_in_p->min_elapsed) r_out_p->min_elapsed = r_in_p->min_elapsed;
+  if (r_out_p->max_elapsed < r_in_p->max_elapsed) r_out_p->max_elapsed = r_in_p->max_elapsed;
+  r_out_p->thread_ns += r_in_p->thread_ns;
+  FOREACH(op, MAX_SIZE_CLASSES) {
+    r_out_p->rec_class_ios[op] += r_in_p->rec_class_ios[op];
+    r_out_p->rec_class_bytes[op] += r_in_p->rec_class_bytes[op];
+    r_out_p->fsz_class_files[op] += r_in_p->fsz_class_files[op];
+  }
+  FOREACH(op, FILE_PHASES) {
+    r_out_p->file_phase_ns[op] += r_in_p->file_phase_ns[op];
+    r_out_p->file_phase_count[op] += r_in_p->file_phase_count[op];
+  }
+  cpu_usage_add(&r_in_p->cpu, &r_out_p->cpu);
+  cpu_usage_add(&r_in_p->proc_cpu, &r_out_p->proc_cpu);
+  r_out_p->paced_ops += r_in_p->paced_ops;
+  r_out_p->late_ops += r_in_p->late_ops;
+  if (r_out_p->max_lag_ns < r_in_p->max_lag_ns) r_out_p->max_lag_ns = r_in_p->max_lag_ns;
+  r_out_p->lag_sum_ns += r_in_p->lag_sum_ns;
+  r_out_p->pace_sleep_ns += r_in_p->pace_sleep_ns;
+  r_out_p->replay_errors += r_in_p->replay_errors;
+  r_out_p->warming += r_in_p->warming;
+  if (r_in_p->sw_taken) {
+    r_out_p->sw_taken = 1;
+    r_out_p->sw_bytes += r_in_p->sw_bytes;
+    r_out_p->sw_ios += r_in_p->sw_ios;
+    r_out_p->sw_files += r_in_p->sw_files;
+    r_out_p->sw_mbps += r_in_p->sw_mbps;
+    r_out_p->sw_iops += r_in_p->sw_iops;
+    r_out_p->sw_fps += r_in_p->sw_fps;
+  }
   if (r_out_p->end_time < r_in_p->end_time) r_out_p->end_time = r_in_p->end_time;
   r_out_p->total_bytes_xferred += r_in_p->total_bytes_xferred;
   r_out_p->total_io_count += r_in_p->total_io_count;
+  r_out_p->io_calls += r_in_p->io_calls;
   r_out_p->files_read += r_in_p->files_read;
   r_out_p->files_written += r_in_p->files_written;
   r_out_p->files_deleted += r_in_p->files_deleted;
+  r_out_p->metadata_ops += r_in_p->metadata_ops;
+  r_out_p->dirs_created += r_in_p->dirs_created;
+  r_out_p->dirs_removed += r_in_p->dirs_removed;
+  r_out_p->tree_tasks += r_in_p->tree_tasks;
+  r_out_p->tree_steals += r_in_p->tree_steals;
+  r_out_p->entries_listed += r_in_p->entries_listed;
+  FOREACH(op, DIRSZ_CLASSES) {
+    r_out_p->dirsz_dirs[op] += r_in_p->dirsz_dirs[op];
+    r_out_p->dirsz_entries[op] += r_in_p->dirsz_entries[op];
+    r_out_p->dirsz_ns[op] += r_in_p->dirsz_ns[op];
+  }
+  FOREACH(op, OP_TYPES) lat_merge(&r_in_p->lat[op], &r_out_p->lat[op]);
 }
 
-int main(int argc, char * argv[])
+/* make phase p the current one, every process keeps its own process number */
+
+void phase_select( int p )
 {
-  int rc, j, t;
-  uint64_t max_io_requests;
-  gfapi_result_t * result_array;
-  gfapi_result_t aggregate = {0};
+  int proc_num = prm.proc_num;
+
+  prm = phase_prm[p];
+  prm.proc_num = proc_num;
+}
 
-  /* define environment variable inputs */
+/* map the start barrier and per-process result slots, shared with any worker processes we fork */
+
+void proc_shared_create( void )
+{
+  pthread_barrierattr_t attr;
+  size_t sz = sizeof(struct proc_shared) + (size_t )phase_count * prm.processes * sizeof(gfapi_result_t);
+  int rc;
+
+  proc_shared = mmap(NULL, sz, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_ANONYMOUS, -1, 0);
+  if (proc_shared == MAP_FAILED) scallerr("mmap shared process area");
+  pthread_barrierattr_init(&attr);
+  pthread_barrierattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+  rc = pthread_barrier_init(&proc_shared->start_barrier, &attr, prm.processes * prm.threads_per_proc);
+  if (rc != OK) { errno = rc; scallerr("pthread_barrier_init"); }
+  rc = pthread_barrier_init(&proc_shared->phase_barrier, &attr, prm.processes);
+  if (rc != OK) { errno = rc; scallerr("pthread_barrier_init"); }
+  pthread_barrierattr_destroy(&attr);
+}
+
+/* fork GFAPI_PROCESSES workers, which return from here and run the test.
+ * the parent waits for them, prints the aggregate over all processes and exits.
+ * this must happen before libgfapi is initialized, each worker gets its own mount */
+
+void launch_processes( void )
+{
+  pid_t * pids = (pid_t * )calloc(prm.processes, sizeof(pid_t));
+  gfapi_result_t * all_p;
+  int j, k, p, status, exit_status = OK;
+  pid_t pid;
+
+  if (!pids) scallerr("calloc pids");
+  if (posix_memalign((void ** )&all_p, CACHE_LINE, sizeof(gfapi_result_t))) scallerr("posix_memalign");
+  memset(all_p, 0, sizeof(gfapi_result_t));
+  fflush(stdout);
+  FOREACH(j, prm.processes) {
+    pids[j] = fork();
+    if (pids[j] < OK) scallerr("fork");
+    if (pids[j] == 0) {
+      prm.proc_num = j;
+      free(pids);
+      free(all_p);
+      /* keep each worker's report together in the output */
+      setvbuf(stdout, NULL, _IOFBF, 1 << 20);
+      return;
+    }
+  }
+
+  /* if any worker fails, the rest would wait forever at the start barrier */
+  FOREACH(k, prm.processes) {
+    pid = wait(&status);
+    if (pid < OK) scallerr("wait");
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != OK) {
+      printf("worker process %d failed with status 0x%x, stopping the others\n", pid, status);
+      exit_status = NOTOK;
+      FOREACH(j, prm.processes) if (pids[j] != pid) kill(pids[j], SIGTERM);
+    }
+  }
+  if (exit_status == OK) {
+    FOREACH(p, phase_count) {
+      phase_select(p);
+      memset(all_p, 0, sizeof(gfapi_result_t));
+      FOREACH(j, prm.processes) aggregate_result(&proc_shared->proc_results[p * prm.processes + j], all_p);
+      all_p->thread_num = -2;
+      all_p->instance = -1;
+      if (phase_count > 1) printf("phase %d %s results:\n", p, prm.phase_name);
+      print_result(all_p);
+    }
+  }
+  exit(exit_status);
+}
+
+/* read the parameters that may change from one phase of a job file to the next, 
+ * print them and check them.  a run without GFAPI_JOBFILE is a single phase */
+
+void get_phase_params( void )
+{
+  int j, readdir_kb;
+  uint64_t max_io_requests;
+  char * sync_mode_str, * sync_every_str, * warmup_str, * end;
+  char trace_path[1024];
+  double warmup;
 
-  prm.debug = getenv_int("DEBUG", 0);
   prm.rdpct = getenv_float("GFAPI_RDPCT", 0.0);
-  prm.threads_per_proc = getenv_int("GFAPI_THREADS_PER_PROC", 1);
-  prm.trclvl = getenv_int("GFAPI_TRCLVL", 0);
-  prm.glfs_volname = getenv_str("GFAPI_VOLNAME", NULL);
-  prm.glfs_hostname = getenv_str("GFAPI_HOSTNAME", NULL);
-  prm.glfs_transport = getenv_str("GFAPI_TRANSPORT", "tcp");
-  prm.glfs_portnum = getenv_int("GFAPI_PORT", 24007);
-  prm.recsz = getenv_int("GFAPI_RECSZ", 64);
-  prm.filesz_kb = getenv_size64_kb("GFAPI_FSZ", 1024);
+  size_dist_parse("GFAPI_RECSZ", getenv_str("GFAPI_RECSZ", "64"), &prm.rec_dist);
+  size_dist_parse("GFAPI_FSZ", getenv_str("GFAPI_FSZ", "1024"), &prm.fsz_dist);
+  prm.recsz = size_dist_max(&prm.rec_dist);     /* buffers are sized for the largest record */
+  prm.filesz_kb = size_dist_max(&prm.fsz_dist);
   prm.prefix = getenv_str("GFAPI_PREFIX", "f");
   prm.thrd_basedir = getenv_str("GFAPI_BASEDIR", "/tmp" );
-  prm.starting_gun_file = getenv_str("GFAPI_STARTING_GUN", "");
   prm.workload_str = getenv_str("GFAPI_LOAD", "seq-wr");  
   prm.io_requests = (uint64_t )getenv_int("GFAPI_IOREQ", 0);
-  prm.starting_gun_timeout = getenv_int("GFAPI_STARTING_GUN_TIMEOUT", 60);
   prm.fsync_at_close = getenv_int("GFAPI_FSYNC_AT_CLOSE", 0);
-  prm.use_fuse = getenv_int("GFAPI_FUSE", 0);
   prm.o_direct = getenv_int("GFAPI_DIRECT", 0) ? O_DIRECT : 0;
   prm.o_append = getenv_int("GFAPI_APPEND", 0);
   prm.o_overwrite = getenv_int("GFAPI_OVERWRITE", 0);
   prm.filecount = getenv_int("GFAPI_FILES", 100);
   prm.usec_delay_per_file = getenv_int("GFAPI_USEC_DELAY_PER_FILE", 0);
-  /* int dirs_per_dir = getenv_int("GFAPI_DIRS_PER_DIR", 1000); */
+  prm.dirs_per_dir = getenv_int("GFAPI_DIRS_PER_DIR", 1000);
+  prm.dir_depth = getenv_int("GFAPI_DIR_DEPTH", 1);
+  prm.precreate_dirs = getenv_int("GFAPI_PRECREATE_DIRS", 1);
   prm.files_per_dir = getenv_int("GFAPI_FILES_PER_DIR", 1000);
+  prm.qdepth = getenv_int("GFAPI_QDEPTH", 1);
+  prm.iov = getenv_int("GFAPI_IOV", 1);
+  prm.tree_threads = getenv_int("GFAPI_TREE_THREADS", prm.threads_per_proc * prm.processes);
+  prm.max_inflight = getenv_int("GFAPI_MAX_INFLIGHT", 0);
+  prm.readdir_stat = getenv_int("GFAPI_READDIR_STAT", 0);
+  readdir_kb = getenv_int("GFAPI_READDIR_KB", 32);
+  /* checked before scaling, a negative size would wrap round to a huge unsigned buffer */
+  if (readdir_kb < 1 || readdir_kb > 1024 * 1024) usage("GFAPI_READDIR_KB must be from 1 to 1048576");
+  prm.readdir_bytes = readdir_kb * BYTES_PER_KB;
+  sync_mode_str = getenv_str("GFAPI_SYNC_MODE", "none");
+  sync_every_str = getenv_str("GFAPI_SYNC_EVERY", "1");
+  prm.duration = getenv_int("GFAPI_DURATION", 0);
+  prm.report_interval = getenv_int("GFAPI_REPORT_INTERVAL", 0);
+  prm.stonewall = getenv_int("GFAPI_STONEWALL", 0);
+  prm.target_iops = getenv_float("GFAPI_TARGET_IOPS", 0.0);
+  prm.target_files_per_sec = getenv_float("GFAPI_TARGET_FILES_PER_SEC", 0.0);
+  prm.stonewall_stop = getenv_int("GFAPI_STONEWALL_STOP", 0);
+  if (prm.stonewall_stop) prm.stonewall = 1;
+  warmup_str = getenv_str("GFAPI_WARMUP", "0");
+  prm.steady_cv = getenv_float("GFAPI_STEADY_CV", 0.0);
+  prm.steady_window = getenv_int("GFAPI_STEADY_WINDOW", 10);
+  prm.sample_ms = getenv_int("GFAPI_SAMPLE_MS", 1000);
+  prm.dist_str = getenv_str("GFAPI_DIST", "");
+  prm.drop_cache = getenv_int("GFAPI_DROP_CACHE", 0);
+  prm.trace_file = getenv_str("GFAPI_TRACE_FILE", "");
+  prm.replay_speed = getenv_float("GFAPI_REPLAY_SPEED", 0.0);
+  prm.trace_max_ops = getenv_int("GFAPI_TRACE_MAX_OPS", 4194304);
+  prm.compress_pct = getenv_int("GFAPI_COMPRESS_PCT", -1);
+  prm.dedupe_pct = getenv_int("GFAPI_DEDUPE_PCT", -1);
+  prm.shared_layout_str = getenv_str("GFAPI_SHARED_FILE", "none");
+  prm.shared_all_procs = strcmp(getenv_str("GFAPI_SHARED_SCOPE", "all"), "process") != 0;
+  prm.drop_cache_cmd = getenv_str("GFAPI_DROP_CACHE_CMD", "sync; echo 3 > /proc/sys/vm/drop_caches");
 
-  printf("GLUSTER: \n  volume=%s\n  transport=%s\n  host=%s\n  port=%d\n  fuse?%s\n  trace level=%d\n  start timeout=%d\n", 
-                prm.glfs_volname, prm.glfs_transport, prm.glfs_hostname, prm.glfs_portnum, prm.use_fuse ? "Yes" : "No", prm.trclvl, prm.starting_gun_timeout );
   printf("WORKLOAD:\n  type = %s \n  threads/proc = %d\n  base directory = %s\n  prefix=%s\n"
          "  file size = "UINT64DFMT" KB\n  file count = %d\n  record size = %u KB"
-         "\n  files/dir=%d\n  fsync-at-close? %s \n", 
+         "\n  files/dir=%d\n  directory depth=%d\n  fsync-at-close? %s \n", 
                 prm.workload_str, prm.threads_per_proc, prm.thrd_basedir, prm.prefix, 
                 prm.filesz_kb, prm.filecount, prm.recsz, 
-                prm.files_per_dir, prm.fsync_at_close?"Yes":"No");
+                prm.files_per_dir, prm.dir_depth, prm.fsync_at_close?"Yes":"No");
   if (prm.o_direct) printf("  forcing use of direct I/O with O_DIRECT flag in open call\n");
   if (prm.usec_delay_per_file) printf("  sleeping %d microsec after each file access\n", prm.usec_delay_per_file);
-  if (argc > 1) usage("glfs_io_test doesn't take command line parameters");
+  if (prm.qdepth > 1) printf("  asynchronous I/O with queue depth %d per thread\n", prm.qdepth);
+  if (prm.iov > 1) printf("  vectored I/O with %d records per call\n", prm.iov);
+  if (prm.duration) printf("  running for %d sec\n", prm.duration);
+  if (prm.report_interval) printf("  reporting throughput every %d sec\n", prm.report_interval);
+  if (getenv_int("GFAPI_TARGET_PER_PROC", 0)) {
+    /* targets are for the whole process, split them evenly across its threads */
+    prm.target_iops /= prm.threads_per_proc;
+    prm.target_files_per_sec /= prm.threads_per_proc;
+  }
+  if (prm.target_iops < 0.0 || prm.target_files_per_sec < 0.0) usage("target rates cannot be negative");
+  if (prm.target_iops > 0.0 && prm.target_files_per_sec > 0.0) 
+    usage("use only one of GFAPI_TARGET_IOPS and GFAPI_TARGET_FILES_PER_SEC");
+  if (prm.target_iops > 0.0 && prm.qdepth > 1) usage("GFAPI_TARGET_IOPS paces synchronous I/O, it cannot be used with GFAPI_QDEPTH");
+  if (prm.target_iops > 0.0) printf("  target rate = %.2f I/O requests/sec per thread\n", prm.target_iops);
+  if (prm.target_files_per_sec > 0.0) printf("  target rate = %.2f files/sec per thread\n", prm.target_files_per_sec);
+  if (prm.stonewall) printf("  stonewalling, threads %s when the first thread finishes\n", 
+                            prm.stonewall_stop ? "stop" : "record progress");
+  warmup = strtod(warmup_str, &end);
+  prm.warmup_ns = prm.warmup_ops = 0;
+  if (strcmp(end, "ops") == 0) prm.warmup_ops = (uint64_t )warmup;
+  else if (*end == 0 || strcmp(end, "s") == 0) prm.warmup_ns = (uint64_t )(warmup * NSEC_PER_SEC);
+  if ((*end && strcmp(end, "ops") && strcmp(end, "s")) || warmup < 0.0) 
+    usage2("GFAPI_WARMUP %s must be a number of seconds, or of operations per thread like 1000ops", warmup_str);
+  if (prm.steady_cv < 0.0 || prm.steady_window < 2 || prm.sample_ms < 1) 
+    usage("GFAPI_STEADY_CV cannot be negative, GFAPI_STEADY_WINDOW must be at least 2 and GFAPI_SAMPLE_MS at least 1");
+  if ((prm.warmup_ns || prm.warmup_ops) && prm.stonewall) 
+    usage("GFAPI_STONEWALL measures from the start of the run, it cannot be used with GFAPI_WARMUP");
+  if (prm.warmup_ops) printf("  first "UINT64DFMT" operations of each thread are warm-up\n", prm.warmup_ops);
+  if (prm.warmup_ns) printf("  first %.2f sec of each thread are warm-up\n", prm.warmup_ns / NSEC_PER_SEC);
+  if (prm.steady_cv > 0.0) printf("  stopping when the last %d samples of %d msec vary by less than CoV %.4f\n", 
+                                  prm.steady_window, prm.sample_ms, prm.steady_cv);
+  if (prm.drop_cache) printf("  dropping caches first with: %s\n", prm.drop_cache_cmd);
+  prm.gen_content = (prm.compress_pct >= 0 || prm.dedupe_pct >= 0);
+  if (prm.compress_pct < 0) prm.compress_pct = 0;
+  if (prm.dedupe_pct < 0) prm.dedupe_pct = 0;
+  if (prm.compress_pct > 100 || prm.dedupe_pct > 100) usage("GFAPI_COMPRESS_PCT and GFAPI_DEDUPE_PCT must be between 0 and 100");
+  if (prm.gen_content) 
+    printf("  written data is %d%% compressible, %d%% of 4 KB blocks are duplicates\n", prm.compress_pct, prm.dedupe_pct);
   if (prm.o_append && prm.o_overwrite) usage("GFAPI_APPEND and GFAPI_OVERWRITE cannot be used in the same test");
+  if (prm.qdepth < 1) usage("GFAPI_QDEPTH must be at least 1");
+  if (prm.iov < 1 || prm.iov > IOV_MAX) usage("GFAPI_IOV must be between 1 and IOV_MAX");
+  for (j = 0; sync_mode_names[j]; j++) if (strcmp(sync_mode_names[j], sync_mode_str) == 0) break;
+  if (!sync_mode_names[j]) usage2("GFAPI_SYNC_MODE %s must be none, fsync, fdatasync, osync or odsync", sync_mode_str);
+  prm.sync_mode = j;
+  prm.o_sync = (prm.sync_mode == SYNC_OSYNC) ? O_SYNC : (prm.sync_mode == SYNC_ODSYNC) ? O_DSYNC : 0;
+  prm.sync_every = strtoul(sync_every_str, &end, 10);
+  prm.sync_every_ms = 0;
+  if ((*end && strcmp(end, "ms")) || prm.sync_every < 1) 
+    usage2("GFAPI_SYNC_EVERY %s must be a number of records, or of milliseconds like 10ms", sync_every_str);
+  if (*end) prm.sync_every_ms = prm.sync_every;
+  if (prm.sync_mode == SYNC_FSYNC || prm.sync_mode == SYNC_FDATASYNC) {
+    if (prm.qdepth > 1) usage("GFAPI_SYNC_MODE fsync and fdatasync sync between synchronous writes, they cannot be used with GFAPI_QDEPTH");
+    if (prm.sync_every_ms) printf("  %s every %u msec while writing\n", sync_mode_str, prm.sync_every_ms);
+    else printf("  %s every %u records written\n", sync_mode_str, prm.sync_every);
+  } else if (prm.o_sync) {
+    printf("  files opened for writing with %s\n", prm.o_sync == O_SYNC ? "O_SYNC" : "O_DSYNC");
+  }
+  if (prm.iov > 1 && prm.qdepth > 1) usage("GFAPI_IOV does synchronous vectored calls, it cannot be used with GFAPI_QDEPTH");
+  if (prm.files_per_dir < 1) usage("GFAPI_FILES_PER_DIR must be at least 1");
+  if (prm.dir_depth < 1 || prm.dir_depth > 32) usage("GFAPI_DIR_DEPTH must be between 1 and 32");
+  if (prm.dir_depth > 1 && prm.dirs_per_dir < 1) usage("GFAPI_DIRS_PER_DIR must be at least 1");
+  if (prm.dir_depth > 1) printf("  subdirectories/dir=%d\n", prm.dirs_per_dir);
+  if (prm.duration < 0 || prm.report_interval < 0) usage("GFAPI_DURATION and GFAPI_REPORT_INTERVAL cannot be negative");
+  if (prm.duration && prm.filecount < 1) usage("GFAPI_DURATION needs GFAPI_FILES of at least 1");
 
   /* validate inputs */
 
@@ -674,10 +4227,47 @@ int main(int argc, char * argv[])
   if (prm.filesz_kb < prm.recsz) {
     printf("  truncating record size %u KB to file size %lu KB\n", prm.recsz, prm.filesz_kb );
     prm.recsz = prm.filesz_kb;
+    FOREACH(j, prm.rec_dist.count) if (prm.rec_dist.kb[j] > prm.recsz) prm.rec_dist.kb[j] = prm.recsz;
   }
+  if (prm.rec_dist.count > 1 || prm.fsz_dist.count > 1) {
+    FOREACH(j, prm.rec_dist.count) 
+      printf("  record size class %d = "UINT64DFMT" KB, %.1f%%\n", j, prm.rec_dist.kb[j], 
+             100.0 * (prm.rec_dist.cum[j] - (j ? prm.rec_dist.cum[j-1] : 0.0)));
+    FOREACH(j, prm.fsz_dist.count) 
+      printf("  file size class %d = "UINT64DFMT" KB, %.1f%%\n", j, prm.fsz_dist.kb[j], 
+             100.0 * (prm.fsz_dist.cum[j] - (j ? prm.fsz_dist.cum[j-1] : 0.0)));
+  }
+  if (strcmp(prm.shared_layout_str, "none") == 0) prm.shared_layout = SHARED_NONE;
+  else if (strcmp(prm.shared_layout_str, "strided") == 0) prm.shared_layout = SHARED_STRIDED;
+  else if (strcmp(prm.shared_layout_str, "blocked") == 0) prm.shared_layout = SHARED_BLOCKED;
+  else if (strcmp(prm.shared_layout_str, "random") == 0) prm.shared_layout = SHARED_RANDOM;
+  else usage2("GFAPI_SHARED_FILE %s must be none, strided, blocked or random", prm.shared_layout_str);
+  if (prm.fsz_dist.count > 1 && 
+      (prm.workload_type == WL_RNDRD || prm.workload_type == WL_RNDWR || prm.shared_layout != SHARED_NONE))
+    usage("a list of file sizes in GFAPI_FSZ only works with sequential workloads on separate files");
   max_io_requests = prm.filesz_kb / prm.recsz;
-  if (prm.workload_type == WL_RNDRD || prm.workload_type == WL_RNDWR) {
+  if (prm.iov > 1 && (prm.shared_layout || (prm.workload_type > WL_RNDRD && prm.workload_type != WL_SEQRDWRMIX)))
+    usage("GFAPI_IOV works with seq-wr, seq-rd, rnd-wr, rnd-rd and seq-rdwrmix, without GFAPI_SHARED_FILE");
+  if (prm.shared_layout) {
+    /* GFAPI_FSZ is the size of the shared file, each thread does its share of the records once */
+    if (prm.workload_type > WL_RNDRD)
+      usage("GFAPI_SHARED_FILE works with seq-wr, seq-rd, rnd-wr and rnd-rd");
+    if (prm.o_append || strlen(prm.dist_str) > 0) 
+      usage("GFAPI_SHARED_FILE cannot be used with GFAPI_APPEND or GFAPI_DIST");
+    prm.sharers = prm.threads_per_proc * (prm.shared_all_procs ? prm.processes : 1);
+    if (max_io_requests < (uint64_t )prm.sharers) 
+      usage("GFAPI_FSZ must hold at least one record for each thread sharing the file");
+    if (prm.io_requests == 0 || prm.io_requests > max_io_requests / prm.sharers) 
+      prm.io_requests = max_io_requests / prm.sharers;
+    prm.filecount = 1;
+    printf("  shared file, %s layout, %d threads %s, "UINT64DFMT" requests per thread\n", prm.shared_layout_str, prm.sharers, 
+           prm.shared_all_procs ? "in all processes" : "per process", prm.io_requests);
+  } else if (prm.workload_type == WL_RNDRD || prm.workload_type == WL_RNDWR) {
     if (prm.io_requests == 0) prm.io_requests = max_io_requests;
+    /* with GFAPI_IOV, random calls each do a whole group of consecutive records */
+    if (prm.iov > 1 && (max_io_requests < (uint64_t )prm.iov || prm.io_requests < (uint64_t )prm.iov)) 
+      usage("GFAPI_IOV is more records than a file holds or GFAPI_IOREQ asks for");
+    prm.io_requests -= prm.io_requests % prm.iov;
     printf("  random read/write requests = "UINT64DFMT"\n", prm.io_requests);
     if (prm.io_requests > max_io_requests) {
         usage("GFAPI_IOREQ too large for file size and record size");
@@ -686,63 +4276,407 @@ int main(int argc, char * argv[])
     prm.io_requests = max_io_requests;
   }
   if (prm.debug) printf("max_io_requests = %ld\n", (long )max_io_requests);
+  prm.records_per_file = max_io_requests;
 
-  srandom(time(NULL));
+  prm.seed = (uint64_t )getenv_int("GFAPI_SEED", 0);
+  if (!prm.seed) prm.seed = (uint64_t )time(NULL);
+  printf("  random seed = "UINT64DFMT"\n", prm.seed);
+  dist_parse(prm.dist_str, &prm.file_dist);
+  if (prm.file_dist.type != DIST_NONE && prm.filecount < 1) usage("GFAPI_DIST needs GFAPI_FILES of at least 1");
+  prm.offset_dist = prm.file_dist;
+  dist_init(&prm.file_dist, prm.filecount);
+  dist_init(&prm.offset_dist, prm.records_per_file / prm.iov);
+  if (prm.file_dist.type != DIST_NONE) printf("  access distribution = %s\n", prm.dist_str);
   prm.bytes_to_xfer = prm.recsz * BYTES_PER_KB;
+  if (prm.workload_type >= WL_FIRST_TREE) {
+    if (prm.qdepth > 1 || prm.shared_layout || prm.duration || prm.file_dist.type != DIST_NONE)
+      usage("rmtree, prepopulate, readdir and find do not use GFAPI_QDEPTH, GFAPI_SHARED_FILE, GFAPI_DURATION or GFAPI_DIST");
+    if (prm.target_iops > 0.0 || prm.target_files_per_sec > 0.0) usage("rmtree, prepopulate, readdir and find run as fast as they can");
+    if (prm.tree_threads < 1) usage("GFAPI_TREE_THREADS must be at least 1");
+    if (prm.max_inflight < 0) usage("GFAPI_MAX_INFLIGHT cannot be negative");
+    if (prm.workload_type == WL_RMTREE) printf("  removing everything below %s\n", prm.thrd_basedir);
+    else if (prm.workload_type == WL_FIND) printf("  listing every directory below %s\n", prm.thrd_basedir);
+    else printf("  %s the files of %d threads\n", prm.workload_type == WL_READDIR ? "listing the directories of" : "making", 
+                prm.tree_threads);
+    if ((prm.workload_type == WL_READDIR || prm.workload_type == WL_FIND) && prm.use_fuse) {
+      printf("  getdents64 with a %u KB buffer\n", prm.readdir_bytes / BYTES_PER_KB);
+      if (prm.bytes_to_xfer < prm.readdir_bytes) prm.bytes_to_xfer = prm.readdir_bytes;
+    }
+    if (prm.readdir_stat) printf("  stat of every entry listed\n");
+    if (prm.warmup_ns || prm.warmup_ops || prm.steady_cv > 0.0) 
+      usage("rmtree, prepopulate, readdir and find do a fixed amount of work, they do not use GFAPI_WARMUP or GFAPI_STEADY_CV");
+    if (prm.max_inflight) printf("  at most %d file operations in flight per process\n", prm.max_inflight);
+  }
+  if (prm.workload_type == WL_REPLAY) {
+    if (strlen(prm.trace_file) == 0) usage("the replay workload needs GFAPI_TRACE_FILE");
+    if (prm.qdepth > 1 || prm.shared_layout) usage("the replay workload does not use GFAPI_QDEPTH or GFAPI_SHARED_FILE");
+    if (prm.target_iops > 0.0 || prm.target_files_per_sec > 0.0) 
+      usage("replay timing comes from the trace, use GFAPI_REPLAY_SPEED instead of a target rate");
+    if (prm.replay_speed < 0.0) usage("GFAPI_REPLAY_SPEED cannot be negative");
+    prm.replay = trace_map(prm.trace_file);
+    if (prm.replay_speed > 0.0) printf("  replaying at %.2fx the trace's own timing\n", prm.replay_speed);
+    else printf("  replaying as fast as possible\n");
+    /* one buffer holds the largest read or write in the trace */
+    if (prm.replay->max_len > prm.bytes_to_xfer) prm.bytes_to_xfer = (prm.replay->max_len + 4095) & ~4095U;
+  } else if (strlen(prm.trace_file) > 0) {
+    if (prm.workload_type >= WL_FIRST_METADATA && 
+        prm.workload_type != WL_STAT && prm.workload_type != WL_CREATE && prm.workload_type != WL_MKDIR)
+      usage("GFAPI_TRACE_FILE can record data workloads, unlink, stat, create and mkdir");
+    if (prm.trace_max_ops < prm.threads_per_proc) usage("GFAPI_TRACE_MAX_OPS must be at least GFAPI_THREADS_PER_PROC");
+    trace_record_path(trace_path, sizeof(trace_path), -1);
+    printf("  recording a trace of every operation in %s\n", trace_path);
+  }
+}
 
-  /* initialize libgfapi instance */
+/* these are fixed for the whole run, so they cannot be set inside a job file */
 
-  if (!prm.use_fuse) {
-    char logfilename[100];
-    /* mount volume */
-    glfs_p = glfs_new(prm.glfs_volname);
-    if (!glfs_p) scallerr("ERROR: could not initialize Gluster volume mount with volname");
+static const char * job_fixed_vars[] = {
+  "DEBUG", "GFAPI_VOLNAME", "GFAPI_HOSTNAME", "GFAPI_TRANSPORT", "GFAPI_PORT", "GFAPI_FUSE", "GFAPI_TRCLVL",
+  "GFAPI_THREADS_PER_PROC", "GFAPI_PROCESSES", "GFAPI_INSTANCES", "GFAPI_STATS_SHM", 
+  "GFAPI_STARTING_GUN", "GFAPI_STARTING_GUN_TIMEOUT", "GFAPI_JOBFILE", 
+  "GFAPI_CPU_LIST", "GFAPI_NUMA_POLICY", "GFAPI_EVENT_CPU_LIST", NULL
+};
+
+/* parse a GFAPI_JOBFILE into phase_prm[].  each line is VARIABLE=value, using the same variables 
+ * as a single run.  a line "[name]" starts a new phase, lines before the first phase apply to every phase.
+ * anything a phase does not set comes from the environment, so each phase is parsed by applying 
+ * its variables with setenv() and then reading parameters just as a single run would */
 
-    sprintf(logfilename, "/tmp/glfs-%d.log", getpid());
-    if (glfs_set_logging(glfs_p, logfilename, prm.trclvl)) scallerr("set_logging");
-  
-    if (glfs_set_volfile_server( glfs_p, prm.glfs_transport, prm.glfs_hostname, prm.glfs_portnum ))
-        scallerr("ERROR: could not initialize gfapi mount");
+void read_job_file( const char * path )
+{
+  FILE * f = fopen(path, "r");
+  char line[1024];
+  char ** keys = NULL, ** values = NULL, ** saved = NULL, ** names = NULL;
+  int * line_phase = NULL;
+  int nlines = 0, phase = -1, n, j, p;
+  char * l, * eq, * end;
 
-    rc = glfs_init(glfs_p);
-    if (rc) scallerr("glfs_init");
+  if (!f) scallerr(path);
+  while (fgets(line, sizeof(line), f)) {
+    for (l = line; isspace(*l); l++) ;
+    for (end = l + strlen(l); end > l && isspace(end[-1]); end--) ;
+    *end = 0;
+    if (*l == 0 || *l == '#') continue;
+    if (*l == '[') {
+      if (end[-1] != ']' || end - l < 3) usage2("job file: bad phase name %s", l);
+      end[-1] = 0;
+      phase++;
+      names = (char ** )realloc(names, (phase + 1) * sizeof(char * ));
+      if (!names || !(names[phase] = strdup(l + 1))) scallerr("job file phase name");
+      continue;
+    }
+    eq = strchr(l, '=');
+    if (!eq || eq == l) usage2("job file: expected VARIABLE=value, got %s", l);
+    *eq = 0;
+    for (j = 0; job_fixed_vars[j]; j++)
+      if (strcmp(job_fixed_vars[j], l) == 0) usage2("job file: %s must be the same for all phases", l);
+    keys = (char ** )realloc(keys, (nlines + 1) * sizeof(char * ));
+    values = (char ** )realloc(values, (nlines + 1) * sizeof(char * ));
+    line_phase = (int * )realloc(line_phase, (nlines + 1) * sizeof(int));
+    if (!keys || !values || !line_phase) scallerr("realloc job file");
+    keys[nlines] = strdup(l);
+    values[nlines] = strdup(eq + 1);
+    if (!keys[nlines] || !values[nlines]) scallerr("strdup job file");
+    line_phase[nlines++] = phase;
   }
+  fclose(f);
+  phase_count = phase + 1;
+  if (phase_count < 1) usage2("job file %s has no [phase] sections", path);
 
-  /* allocate and initialize per-thread structure and start each thread */
+  /* remember what the environment said, so one phase's settings don't leak into the next */
+  saved = (char ** )calloc(nlines + 1, sizeof(char * ));
+  if (!saved) scallerr("calloc job file");
+  FOREACH(n, nlines) {
+    char * v = getenv(keys[n]);
+    if (v && !(saved[n] = strdup(v))) scallerr("strdup job file");
+  }
 
-  result_array = (gfapi_result_t * )calloc(prm.threads_per_proc, sizeof(gfapi_result_t));
-  FOREACH(t, prm.threads_per_proc) {
-    gfapi_result_t * next_result_p = &result_array[t];
-    next_result_p->thread_num = t;
-    rc = pthread_create(&next_result_p->thr, NULL, gfapi_thread_run, next_result_p);
-    if (rc != OK) scallerr("pthread_create");
+  phase_prm = (struct gfapi_prm * )calloc(phase_count, sizeof(struct gfapi_prm));
+  if (!phase_prm) scallerr("calloc phases");
+  FOREACH(p, phase_count) {
+    FOREACH(n, nlines) {
+      if (saved[n]) setenv(keys[n], saved[n], 1);
+      else unsetenv(keys[n]);
+    }
+    FOREACH(n, nlines) 
+      if (line_phase[n] < 0 || line_phase[n] == p) setenv(keys[n], values[n], 1);
+    prm.phase_num = p;
+    prm.phase_name = names[p];
+    printf("PHASE %d: %s\n", p, names[p]);
+    get_phase_params();
+    phase_prm[p] = prm;
   }
-   
-  /* wait for each thread to finish */
+}
 
-  FOREACH(t, prm.threads_per_proc) {
-    void * retval;
-    gfapi_result_t * next_result_p = &result_array[t];
-    rc = pthread_join( next_result_p->thr, &retval );
-    if (rc != OK) {
-      printf("thread %d return code %d\n", t, rc);
+/* run the drop-cache command before a phase.  the default empties the client's kernel page cache, 
+ * which is what a GFAPI_FUSE run reads through.  caches inside a libgfapi mount are not affected, 
+ * so to measure cold reads there, have the command drop caches on the servers (e.g. over ssh) */
+
+void drop_caches( void )
+{
+  int rc;
+
+  printf("%s : dropping caches with: %s\n", now_str(), prm.drop_cache_cmd);
+  fflush(stdout);
+  rc = system(prm.drop_cache_cmd);
+  if (rc < OK) scallerr("system");
+  if (rc != OK) {
+    printf("drop cache command failed with status 0x%x\n", rc);
+    errno = ECHILD;
+    scallerr(prm.drop_cache_cmd);
+  }
+}
+
+int main(int argc, char * argv[])
+{
+  int rc, j, t, p, sampling;
+  pthread_t reporter_thr, sampler_thr;
+  live_stats_t * live_array;
+  gfapi_result_t * result_array;
+  char * job_file, * cpu_list_str, * numa_policy_str, * event_cpu_list_str;
+  struct rusage ru_end;
+  static int list[CPU_SETSIZE];
+  static gfapi_result_t aggregate = {0};  /* static because latency histograms make it large */
+
+  /* GFAPI_TRACE_IMPORT only converts a text trace, no volume is needed */
+
+  if (strlen(getenv_str("GFAPI_TRACE_IMPORT", "")) > 0) {
+    if (strlen(getenv_str("GFAPI_TRACE_FILE", "")) == 0) usage("GFAPI_TRACE_IMPORT needs GFAPI_TRACE_FILE to write");
+    trace_import(getenv_str("GFAPI_TRACE_IMPORT", ""), getenv_str("GFAPI_TRACE_FILE", ""), getenv_str("GFAPI_TRACE_STRIP", ""));
+    return OK;
+  }
+
+  /* define environment variable inputs that stay the same for every phase */
+
+  prm.debug = getenv_int("DEBUG", 0);
+  prm.threads_per_proc = getenv_int("GFAPI_THREADS_PER_PROC", 1);
+  prm.processes = getenv_int("GFAPI_PROCESSES", 1);
+  prm.trclvl = getenv_int("GFAPI_TRCLVL", 0);
+  prm.glfs_volname = getenv_str("GFAPI_VOLNAME", NULL);
+  prm.glfs_hostname = getenv_str("GFAPI_HOSTNAME", NULL);
+  prm.glfs_transport = getenv_str("GFAPI_TRANSPORT", "tcp");
+  prm.glfs_portnum = getenv_int("GFAPI_PORT", 24007);
+  prm.starting_gun_file = getenv_str("GFAPI_STARTING_GUN", "");
+  prm.starting_gun_timeout = getenv_int("GFAPI_STARTING_GUN_TIMEOUT", 60);
+  prm.use_fuse = getenv_int("GFAPI_FUSE", 0);
+  prm.instances = getenv_int("GFAPI_INSTANCES", 1);
+  prm.stats_shm = getenv_int("GFAPI_STATS_SHM", 0);
+  job_file = getenv_str("GFAPI_JOBFILE", "");
+  cpu_list_str = getenv_str("GFAPI_CPU_LIST", "");
+  numa_policy_str = getenv_str("GFAPI_NUMA_POLICY", "default");
+  event_cpu_list_str = getenv_str("GFAPI_EVENT_CPU_LIST", "");
+
+  printf("GLUSTER: \n  volume=%s\n  transport=%s\n  host=%s\n  port=%d\n  fuse?%s\n  trace level=%d\n  start timeout=%d\n", 
+                prm.glfs_volname, prm.glfs_transport, prm.glfs_hostname, prm.glfs_portnum, prm.use_fuse ? "Yes" : "No", prm.trclvl, prm.starting_gun_timeout );
+  if (argc > 1) usage("glfs_io_test doesn't take command line parameters");
+  if (prm.instances < 1) usage("GFAPI_INSTANCES must be at least 1");
+  if (prm.processes < 1 || prm.threads_per_proc < 1) usage("GFAPI_PROCESSES and GFAPI_THREADS_PER_PROC must be at least 1");
+  if (prm.processes > 1) printf("  worker processes = %d\n", prm.processes);
+  if (prm.instances > 1) printf("  %d libgfapi instances, threads assigned round-robin\n", prm.instances);
+  if (prm.instances > 1 && prm.use_fuse) usage("GFAPI_INSTANCES only applies to libgfapi, not GFAPI_FUSE");
+  if (prm.instances > prm.threads_per_proc) usage("GFAPI_INSTANCES cannot exceed GFAPI_THREADS_PER_PROC");
+
+  /* thread and memory placement */
+
+  numa_topology_init();
+  if (strlen(cpu_list_str) > 0) {
+    prm.cpu_count = parse_int_list(cpu_list_str, list, CPU_SETSIZE);
+    if (prm.cpu_count < 1) usage2("GFAPI_CPU_LIST %s is not a list like 0-3,8", cpu_list_str);
+    prm.cpu_list = (int * )calloc(prm.cpu_count, sizeof(int));
+    if (!prm.cpu_list) scallerr("calloc cpu list");
+    memcpy(prm.cpu_list, list, prm.cpu_count * sizeof(int));
+    printf("  worker threads pinned round-robin to cpus %s\n", cpu_list_str);
+  }
+  if (strcmp(numa_policy_str, "default") == 0) {
+    prm.numa_policy = NUMA_DEFAULT;
+  } else if (strcmp(numa_policy_str, "local") == 0) {
+    prm.numa_policy = NUMA_LOCAL;
+  } else if (strncmp(numa_policy_str, "nodes:", 6) == 0) {
+    prm.numa_policy = NUMA_NODES;
+    prm.numa_node_count = parse_int_list(numa_policy_str + 6, list, MAX_NUMA_NODES);
+    if (prm.numa_node_count < 1) usage2("GFAPI_NUMA_POLICY %s needs a node list like nodes:0,1", numa_policy_str);
+    prm.numa_node_list = (int * )calloc(prm.numa_node_count, sizeof(int));
+    if (!prm.numa_node_list) scallerr("calloc node list");
+    FOREACH(j, prm.numa_node_count) {
+      if (list[j] >= numa_nodes || CPU_COUNT(&node_cpus[list[j]]) == 0) 
+        usage2("GFAPI_NUMA_POLICY %s names a node with no CPUs", numa_policy_str);
+      prm.numa_node_list[j] = list[j];
+    }
+  } else {
+    usage2("GFAPI_NUMA_POLICY %s must be default, local or nodes:list", numa_policy_str);
+  }
+  if (prm.numa_policy != NUMA_DEFAULT) printf("  NUMA policy = %s, %d nodes\n", numa_policy_str, numa_nodes);
+  CPU_ZERO(&prm.event_cpus);
+  if (strlen(event_cpu_list_str) > 0) {
+    int n = parse_int_list(event_cpu_list_str, list, CPU_SETSIZE);
+    if (n < 1) usage2("GFAPI_EVENT_CPU_LIST %s is not a list like 0-3,8", event_cpu_list_str);
+    if (prm.use_fuse) usage("GFAPI_EVENT_CPU_LIST only applies to libgfapi, not GFAPI_FUSE");
+    FOREACH(j, n) CPU_SET(list[j], &prm.event_cpus);
+    printf("  libgfapi threads pinned to cpus %s\n", event_cpu_list_str);
+  }
+
+  /* read every phase's parameters up front, so a mistake in a later phase is caught before any work is done */
+
+  if (strlen(job_file) > 0) {
+    printf("JOB FILE: %s\n", job_file);
+    read_job_file(job_file);
+  } else {
+    phase_prm = (struct gfapi_prm * )calloc(1, sizeof(struct gfapi_prm));
+    if (!phase_prm) scallerr("calloc phases");
+    get_phase_params();
+    phase_prm[0] = prm;
+  }
+  phase_select(0);
+  FOREACH(p, phase_count) if (phase_prm[p].gen_content && !content_pool) content_pool_init();
+
+  /* start worker processes, everything after this runs in each of them */
+
+  proc_shared_create();
+  if (prm.processes > 1) launch_processes();
+
+  /* initialize libgfapi instances */
+
+  if (!prm.use_fuse) {
+    pthread_t * init_thr = (pthread_t * )calloc(prm.instances, sizeof(pthread_t));
+    glfs_instances = (glfs_t ** )calloc(prm.instances, sizeof(glfs_t * ));
+    if (!init_thr || !glfs_instances) scallerr("calloc instances");
+    FOREACH(j, prm.instances) {
+      rc = pthread_create(&init_thr[j], NULL, glfs_instance_init_run, (void * )(intptr_t )j);
+      if (rc != OK) scallerr("pthread_create");
+    }
+    FOREACH(j, prm.instances) pthread_join(init_thr[j], NULL);
+    free(init_thr);
+  }
+
+  /* allocate and initialize per-thread structure and start each thread */
+
+  /* each result is cache-line aligned so neighbouring threads' counters never share a line */
+  if (posix_memalign((void ** )&result_array, CACHE_LINE, prm.threads_per_proc * sizeof(gfapi_result_t)))
+    scallerr("posix_memalign results");
+  live_array = live_stats_create(prm.threads_per_proc);
+
+  /* run each phase with the same mounts, starting fresh threads and results each time */
+
+  FOREACH(p, phase_count) {
+    phase_select(p);
+    if (p > 0) {
+      /* all processes must finish the previous phase before caches are dropped or anyone starts again */
+      rc = pthread_barrier_wait(&proc_shared->phase_barrier);
+      if (rc != OK && rc != PTHREAD_BARRIER_SERIAL_THREAD) { errno = rc; scallerr("pthread_barrier_wait"); }
+      /* the previous phase's stop flags are cleared before any process can start its threads or sampler, 
+       * and not while some process might still be stopping because of them.  the first phase finds them zero */
+      if (prm.proc_num == 0) {
+        proc_shared->stonewall_ns = 0;
+        proc_shared->steady_ns = 0;
+      }
+      rc = pthread_barrier_wait(&proc_shared->phase_barrier);
+      if (rc != OK && rc != PTHREAD_BARRIER_SERIAL_THREAD) { errno = rc; scallerr("pthread_barrier_wait"); }
+       if (phase_count > 1) printf("%s : starting phase %d %s\n", now_str(), p, prm.phase_name);
     }
-    if (retval == PTHREAD_CANCELED) {
-      printf("thread %d cancelled\n", t);
+    /* other processes' threads cannot get past the start barrier until process 0 has started its threads */
+    if (prm.proc_num == 0 && prm.drop_cache) drop_caches();
+    memset(result_array, 0, prm.threads_per_proc * sizeof(gfapi_result_t));
+    memset(live_array, 0, prm.threads_per_proc * sizeof(live_stats_t));
+    memset(&aggregate, 0, sizeof(aggregate));
+    live_hdr->recsz_kb = prm.recsz;
+    memset(live_hdr->workload, 0, sizeof(live_hdr->workload));
+    strncpy(live_hdr->workload, prm.workload_str, sizeof(live_hdr->workload)-1);
+    live_hdr->phase = p;
+    live_stats_set_state(LIVE_RUNNING);
+    if (prm.workload_type == WL_REPLAY) replay_shard(result_array);
+    if (prm.workload_type >= WL_FIRST_TREE) tree_setup();
+    trace_t0 = getmono_ns();
+    sampling = (prm.warmup_ns || prm.warmup_ops || prm.steady_cv > 0.0);
+    threads_warming = (prm.warmup_ns || prm.warmup_ops) ? prm.threads_per_proc : 0;
+    FOREACH(t, prm.threads_per_proc) {
+      gfapi_result_t * next_result_p = &result_array[t];
+      next_result_p->thread_num = prm.proc_num * prm.threads_per_proc + t; /* unique across worker processes */
+      next_result_p->live = &live_array[t];
+      next_result_p->instance = t % prm.instances;
+      if (!prm.use_fuse) next_result_p->fs = glfs_instances[next_result_p->instance];
+      rc = pthread_create(&next_result_p->thr, NULL, gfapi_thread_run, next_result_p);
+      if (rc != OK) scallerr("pthread_create");
     }
-    if (retval) {
-      printf("thread %d failed with rc %p\n", t, retval);
+    report_done = 0;
+    if (prm.report_interval) {
+      rc = pthread_create(&reporter_thr, NULL, interval_report_run, live_array);
+      if (rc != OK) scallerr("pthread_create");
     }
+    if (sampling) {
+      rc = pthread_create(&sampler_thr, NULL, sampler_run, live_array);
+      if (rc != OK) scallerr("pthread_create");
+    }
+
+    /* wait for each thread to finish */
+
+    FOREACH(t, prm.threads_per_proc) {
+      void * retval;
+      gfapi_result_t * next_result_p = &result_array[t];
+      rc = pthread_join( next_result_p->thr, &retval );
+      if (rc != OK) {
+        printf("thread %d return code %d\n", t, rc);
+      }
+      if (retval == PTHREAD_CANCELED) {
+        printf("thread %d cancelled\n", t);
+      }
+      if (retval) {
+        printf("thread %d failed with rc %p\n", t, retval);
+      }
+    }
+    if (prm.report_interval || sampling) {
+      pthread_mutex_lock(&report_lock);
+      report_done = 1;
+      pthread_cond_broadcast(&report_cv);
+      pthread_mutex_unlock(&report_lock);
+      if (prm.report_interval) pthread_join(reporter_thr, NULL);
+      if (sampling) pthread_join(sampler_thr, NULL);
+    }
+    if (phase_count > 1) printf("phase %d %s results:\n", p, prm.phase_name);
+    FOREACH(t, prm.threads_per_proc) {
+      print_result(&result_array[t]);
+      aggregate_result(&result_array[t], &aggregate);
+      free(result_array[t].replay_idx);
+    }
+    if (prm.instances > 1) {
+      gfapi_result_t * instance_array = (gfapi_result_t * )calloc(prm.instances, sizeof(gfapi_result_t));
+      if (!instance_array) scallerr("calloc instance results");
+      FOREACH(t, prm.threads_per_proc) 
+        aggregate_result(&result_array[t], &instance_array[result_array[t].instance]);
+      FOREACH(j, prm.instances) {
+        instance_array[j].thread_num = -1;
+        instance_array[j].instance = j;
+        print_result(&instance_array[j]);
+      }
+      free(instance_array);
+    }
+    getrusage(RUSAGE_SELF, &ru_end);
+    cpu_usage_delta(&proc_ru_start, &ru_end, &aggregate.proc_cpu);
+    aggregate.thread_num = -1;
+    aggregate.instance = -1;
+    print_result(&aggregate);
+    if (sampling) print_measurement();
+    if (prm.processes > 1) proc_shared->proc_results[p * prm.processes + prm.proc_num] = aggregate;
+    if (strlen(prm.trace_file) > 0 && prm.workload_type != WL_REPLAY) {
+      /* each worker process writes its own trace */
+      trace_buf_t ** bufs = (trace_buf_t ** )calloc(prm.threads_per_proc, sizeof(trace_buf_t * ));
+      char trace_path[1024];
+      if (!bufs) scallerr("calloc traces");
+      FOREACH(t, prm.threads_per_proc) bufs[t] = result_array[t].trace;
+      trace_record_path(trace_path, sizeof(trace_path), prm.proc_num);
+      trace_save(trace_path, bufs, prm.threads_per_proc);
+      FOREACH(t, prm.threads_per_proc) trace_buf_free(bufs[t]);
+      free(bufs);
+    }
+    fflush(stdout);
   }
+  live_stats_set_state(LIVE_DONE);
+  if (prm.stats_shm) shm_unlink(live_shm_name);
   if (!prm.use_fuse) {
-    rc = glfs_fini(glfs_p);
-    if (rc < OK) scallerr("glfs_fini");
-  }
-  FOREACH(t, prm.threads_per_proc) {
-    print_result(&result_array[t]);
-    aggregate_result(&result_array[t], &aggregate);
+    FOREACH(j, prm.instances) {
+      rc = glfs_fini(glfs_instances[j]);
+      glfs_instances[j] = NULL;
+      if (rc < OK) scallerr("glfs_fini");
+    }
   }
-  aggregate.thread_num = -1;
-  print_result(&aggregate);
   return OK;
 }
@@ -20,6 +20,8 @@
 # PGFAPI_FILESIZE - defaults to 4 (KB), number of KB to write or read per file
 # PGFAPI_EXTERNAL_START - if defined, then then let user fire the starting gun 
 #                           (allows multiple concurrent parallel_gfapi_test.sh runs)
+# PGFAPI_RMTREE_THREADS - threads removing each process directory before a write test (default 8)
+# PGFAPI_RMTREE_INFLIGHT - if non-zero, most file operations each of those removals has in flight (default 0)
 #
 #threads=16
 
@@ -43,6 +45,8 @@ export GFAPI_FSYNC_AT_CLOSE=${PGFAPI_FSYNC_AT_CLOSE:-0}
 export GFAPI_RDPCT=${PGFAPI_RDPCT:-0}
 export GFAPI_THREADS_PER_PROC=${PGFAPI_THREADS_PER_PROC:-1}
 export GFAPI_DIRECT=${PGFAPI_DIRECT:-0}
+rmtree_threads=${PGFAPI_RMTREE_THREADS:-8}
+rmtree_inflight=${PGFAPI_RMTREE_INFLIGHT:-0}
 PROGRAM=${PGFAPI_PROGRAM:-gfapi_perf_test}
 # GFAPI_IOREQ only used for random I/O tests
 export GFAPI_IOREQ=4096
@@ -135,11 +139,11 @@ rm -rf $ALL_LOGS_DIR
 mkdir -p $ALL_LOGS_DIR
 
 
-# if write test then remove files from each per-thread directory tree in parallel
+# if write test then remove each per-process directory tree, files and directories, all trees at once.
+# the threads of each rmtree steal work from each other, so a slow directory doesn't hold up the others
 
 echo "removing any previous files"
 if [ "$GFAPI_LOAD" = "seq-wr" -a "$GFAPI_APPEND" = "0" -a "$GFAPI_OVERWRITE" = 0 ] ; then
- thrdcnt=0
  for c in $clients ; do
   ssh $c 'killall -INT -q rm ; sleep 1 ; killall -q rm'
   for n in `seq -f "%02g" 1 $processes ` ; do 
@@ -147,18 +151,12 @@ if [ "$GFAPI_LOAD" = "seq-wr" -a "$GFAPI_APPEND" = "0" -a "$GFAPI_OVERWRITE" = 0
    if [ "$GFAPI_FUSE" = 1 ] ; then
      d=${MOUNTPOINT}$d
    fi
-   glfs_cmd="GFAPI_LOAD=unlink GFAPI_FUSE=$GFAPI_FUSE GFAPI_FILES=$files GFAPI_BASEDIR=$d GFAPI_VOLNAME=$GFAPI_VOLNAME GFAPI_HOSTNAME=$GFAPI_HOSTNAME GFAPI_THREADS_PER_PROC=$GFAPI_THREADS_PER_PROC $PROGRAM"
+   glfs_cmd="GFAPI_LOAD=rmtree GFAPI_FUSE=$GFAPI_FUSE GFAPI_BASEDIR=$d GFAPI_VOLNAME=$GFAPI_VOLNAME GFAPI_HOSTNAME=$GFAPI_HOSTNAME GFAPI_THREADS_PER_PROC=$rmtree_threads GFAPI_MAX_INFLIGHT=$rmtree_inflight $PROGRAM"
    
-   eval "$glfs_cmd > /tmp/unlink.$c.$n.log 2>&1 &"
+   eval "$glfs_cmd > /tmp/rmtree.$c.$n.log 2>&1 &"
    rmpids="$rmpids $!"
-   (( thrdcnt = $thrdcnt + 1 ))
-   if [ $thrdcnt -gt 25 ] ; then
-     for p in $rmpids ; do wait $p ; done
-     rmpids=""
-     thrdcnt=0
-   fi
   done
-  ssh $c "rm -f /tmp/glfs-*.log /tmp/unlink.*.*.log"
+  ssh $c "rm -f /tmp/glfs-*.log /tmp/rmtree.*.*.log"
  done
  for p in $rmpids ; do wait $p ; done
  rm -f $TOPDIR/*.ready 